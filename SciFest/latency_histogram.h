@@ -0,0 +1,81 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Fixed-size log-linear histogram of nanosecond latencies. Values are binned
+// into power-of-two ranges split into kSubBuckets linear steps (<= 12.5 %
+// relative error), so recording is a couple of integer ops and never allocates.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBits;
+    static constexpr int kOctaves = 40; // octave = msb - kSubBits + 1: up to 2^42 ns, about 73 minutes
+    static constexpr int kBuckets = kOctaves * kSubBuckets;
+
+    void record(uint64_t ns) {
+        ++counts_[bucket_of(ns)];
+        ++count_;
+        sum_ += ns;
+        if (ns < min_) min_ = ns;
+        if (ns > max_) max_ = ns;
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    uint64_t mean() const { return count_ ? sum_ / count_ : 0; }
+
+    // Upper bound of the bucket holding the q-quantile (0 < q <= 1).
+    uint64_t percentile(double q) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count_) + 0.5);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            seen += counts_[b];
+            if (seen >= rank) {
+                const uint64_t upper = upper_bound(b);
+                return upper < max_ ? upper : max_;
+            }
+        }
+        return max_;
+    }
+
+    // One line: "<label> n=.. min=.. p50=.. p90=.. p99=.. max=.. (us)"
+    void print(FILE* out, const char* label) const {
+        std::fprintf(out, "%s n=%llu min=%.1f p50=%.1f p90=%.1f p99=%.1f max=%.1f mean=%.1f (us)\n", label,
+                     static_cast<unsigned long long>(count_), min() / 1e3, percentile(0.50) / 1e3,
+                     percentile(0.90) / 1e3, percentile(0.99) / 1e3, max() / 1e3, mean() / 1e3);
+    }
+
+private:
+    static int bucket_of(uint64_t ns) {
+        if (ns < kSubBuckets) return static_cast<int>(ns);
+        const int msb = 63 - __builtin_clzll(ns);
+        const int octave = msb - kSubBits + 1;
+        const int sub = static_cast<int>((ns >> (msb - kSubBits)) & (kSubBuckets - 1));
+        const int b = octave * kSubBuckets + sub;
+        return b < kBuckets ? b : kBuckets - 1;
+    }
+
+    static uint64_t upper_bound(int b) {
+        const int octave = b / kSubBuckets;
+        const uint64_t sub = static_cast<uint64_t>(b % kSubBuckets);
+        if (octave == 0) return sub;
+        const int shift = octave - 1;
+        return ((static_cast<uint64_t>(kSubBuckets) + sub + 1) << shift) - 1;
+    }
+
+    uint32_t counts_[kBuckets] = {};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -1,17 +1,32 @@
 #include <gpiod.h>
-#include <chrono>
 #include <csignal>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <thread>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#include <sched.h>
 #include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../common/event_log.h"
+#include "../common/link_policy.h"
+#include "../common/metrics.h"
+#include "pump_dispatch.h"
+#include "pump_protocol.h"
+#include "latency_histogram.h"
+#include "trace_ring.h"
+#include "valves.h"
+#include "vent_sense.h"
 
 // You used "BCM pin numbers" in v1. In libgpiod v2 we request by *line offsets* on a gpiochip.
 // On Raspberry Pi these often match BCM numbers on /dev/gpiochip0, but do not assume.
@@ -20,31 +35,128 @@ static constexpr unsigned PUMP_OFFSET = 20; // main solenoid valve
 static constexpr unsigned VENT_OFFSET = 21; // vent/bleed valve
 static const char* CHIP_PATH = "/dev/gpiochip0";
 
+// Defaults for the single-cell setup; --host/--port select the robot of one
+// station in a multi-cell setup (see src/stations.example.json).
 static const char* SERVER_IP = "192.168.0.37";
 static constexpr int SERVER_PORT = 8888;
 
-// Active-low semantics: logical 1 => assert (drive pin LOW)
-enum class ValveState { On, Off };
-enum class State { WAITING, DELIVERING };
+// Debounce of the vacuum switch (--vent-sense); the vent cycle itself is in pump_dispatch.h.
+static constexpr unsigned VENT_SENSE_DEBOUNCE_US = 1000;
 
-static volatile bool keep_running = true;
-void handle_sigint(int) { keep_running = false; }
+// What an epoll_event refers to (stored in epoll_event.data.u64).
+enum class Source : uint64_t { Signal, Stdin, Socket, Heartbeat, LinkTimer, Valves, Prearm, VentSense, MetricsListen, MetricsClient };
 
-static inline void sleep_ms(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
-static inline void sleep_s (int s ) { std::this_thread::sleep_for(std::chrono::seconds(s)); }
+// Opt-in real-time mode (--rt): lock all memory, pin to one (ideally isolated,
+// see isolcpus=) core and run under SCHED_FIFO so a loaded Pi cannot delay the
+// path from "pickup reached" to the solenoid. Needs CAP_SYS_NICE/CAP_IPC_LOCK;
+// failures are reported and the controller keeps running without them.
+struct RtOptions {
+    bool enabled = false;
+    int priority = 80;
+    int cpu = 3;
+};
 
-// v2: you set values on a gpiod_line_request*, addressed by offset
-static inline void set_valve(gpiod_line_request* req, unsigned offset, ValveState state) {
-    const gpiod_line_value v =
-        (state == ValveState::On) ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE;
+static void enable_rt_mode(const RtOptions& rt) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) std::perror("mlockall");
 
-    if (gpiod_line_request_set_value(req, offset, v) < 0) {
-        std::perror("gpiod_line_request_set_value");
+    // Pre-fault a chunk of stack so the hot path never takes a page fault.
+    {
+        volatile unsigned char stack_prefault[256 * 1024];
+        for (size_t i = 0; i < sizeof(stack_prefault); i += 4096) stack_prefault[i] = 0;
     }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(rt.cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) std::perror("sched_setaffinity");
+
+    sched_param sp{};
+    sp.sched_priority = rt.priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) < 0) std::perror("sched_setscheduler(SCHED_FIFO)");
+
+    std::cout << "Real-time mode: SCHED_FIFO prio " << rt.priority << " on CPU " << rt.cpu << "\n";
+}
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--host IP] [--port N] [--prearm-lead MS] [--rt] [--rt-prio N] [--cpu N]\n"
+              << "       " << std::string(std::strlen(prog), ' ') << " [--vent-sense OFFSET] [--vent-sense-chip PATH] [--vent-sense-active-low]\n"
+              << "       " << std::string(std::strlen(prog), ' ') << " [--trace FILE] [--events FILE] [--metrics-port N]\n"
+              << "       " << prog << " --trace-report FILE\n"
+              << "       " << prog << " --events-dump FILE\n";
 }
 
-int main() {
-    std::signal(SIGINT, handle_sigint);
+// Command trace, see trace_ring.h; static so it stays out of the (locked) stack.
+static trace::TraceRing<> tracer;
+
+// Pickup/drop/valve timeline, see event_log.h; a no-op unless --events is given.
+static event_log::EventLog evlog;
+
+// Free records mapped by --events. --rt's mlockall locks the whole mapping, so
+// the pump stays well below the GUI's 32 MiB: 2 MiB is some 6000 deliveries
+// at about ten records each. A full log counts drops instead of growing.
+static constexpr uint64_t EVENT_LOG_CAPACITY = 1u << 16;
+
+int main(int argc, char** argv) {
+    RtOptions rt;
+    const char* server_ip = SERVER_IP;
+    int server_port = SERVER_PORT;
+    uint64_t prearm_lead_ms = 0;
+    int vent_sense_offset = -1;
+    const char* vent_sense_chip = CHIP_PATH;
+    bool vent_sense_active_low = false;
+    const char* trace_path = nullptr;
+    const char* events_path = nullptr;
+    int metrics_port = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            server_ip = argv[++i];
+        } else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            server_port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--prearm-lead") == 0 && i + 1 < argc) {
+            prearm_lead_ms = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--vent-sense") == 0 && i + 1 < argc) {
+            vent_sense_offset = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--vent-sense-chip") == 0 && i + 1 < argc) {
+            vent_sense_chip = argv[++i];
+        } else if (std::strcmp(argv[i], "--vent-sense-active-low") == 0) {
+            vent_sense_active_low = true;
+        } else if (std::strcmp(argv[i], "--rt") == 0) {
+            rt.enabled = true;
+        } else if (std::strcmp(argv[i], "--rt-prio") == 0 && i + 1 < argc) {
+            rt.priority = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            rt.cpu = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            events_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            metrics_port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--events-dump") == 0 && i + 1 < argc) {
+            std::vector<event_log::Record> records;
+            if (!event_log::read_file(argv[++i], records)) return 1;
+            event_log::print(stdout, records);
+            return 0;
+        } else if (std::strcmp(argv[i], "--trace-report") == 0 && i + 1 < argc) {
+            // Offline mode: summarise a trace written by an earlier --trace run.
+            static trace::Record records[decltype(tracer)::capacity()];
+            const size_t n = trace::read_file(argv[++i], records, tracer.capacity());
+            trace::report(stdout, records, n);
+            return n > 0 ? 0 : 1;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (events_path && !evlog.open(events_path, event_log::Source::Pump, EVENT_LOG_CAPACITY)) return 1;
+    if (rt.enabled) enable_rt_mode(rt);
+
+    // SIGINT/SIGTERM are consumed through a signalfd in the event loop.
+    sigset_t sigmask;
+    sigemptyset(&sigmask);
+    sigaddset(&sigmask, SIGINT);
+    sigaddset(&sigmask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &sigmask, nullptr);
 
     // ---- libgpiod v2 setup ----
     gpiod_chip* chip = gpiod_chip_open(CHIP_PATH);
@@ -58,6 +170,8 @@ int main() {
     // Match your v1 semantics: ACTIVE_LOW flag.
     // With active-low set, "value=1" means "active" => physical LOW.
     gpiod_line_settings_set_active_low(settings, true);
+    // Lines come up inactive (pump off, vent closed) in the request itself.
+    gpiod_line_settings_set_output_value(settings, GPIOD_LINE_VALUE_INACTIVE);
 
     gpiod_line_config* lcfg = gpiod_line_config_new();
     if (!lcfg) {
@@ -106,17 +220,22 @@ int main() {
         return 1;
     }
 
+    // v2: values are set on the gpiod_line_request, addressed by offset; the bank
+    // batches both offsets into one ioctl.
+    ValveBank<2> bank(req, {PUMP_OFFSET, VENT_OFFSET});
+
     // Start OFF: pump off, vent closed
-    set_valve(req, PUMP_OFFSET, ValveState::Off);
-    set_valve(req, VENT_OFFSET, ValveState::Off);
+    bank.stage(PUMP_OFFSET, ValveState::Off);
+    bank.stage(VENT_OFFSET, ValveState::Off);
+    bank.commit();
 
     // ---- Socket setup - connect to server ----
-    int sockfd;
+    int sockfd = -1;
     struct sockaddr_in serv_addr;
     memset(&serv_addr, 0, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(SERVER_PORT);
-    if (inet_pton(AF_INET, SERVER_IP, &serv_addr.sin_addr) <= 0) {
+    serv_addr.sin_port = htons(server_port);
+    if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0) {
         std::perror("inet_pton");
         gpiod_line_request_release(req);
         gpiod_request_config_free(rcfg);
@@ -126,43 +245,22 @@ int main() {
         return 1;
     }
 
-    std::cout << "Attempting to connect to server at " << SERVER_IP << ":" << SERVER_PORT << "\n";
-    while (keep_running) {
-        sockfd = socket(AF_INET, SOCK_STREAM, 0);
-        if (sockfd < 0) { std::perror("socket"); break; }
-
-        fcntl(sockfd, F_SETFL, O_NONBLOCK);
-        int res = connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
-        if (res == 0) {
-            std::cout << "Connected to server at " << SERVER_IP << ":" << SERVER_PORT << "\n";
-            break;
-        } else if (errno == EINPROGRESS) {
-            fd_set writefds;
-            FD_ZERO(&writefds);
-            FD_SET(sockfd, &writefds);
-            struct timeval tv = {5, 0};
-            int retval = select(sockfd + 1, NULL, &writefds, NULL, &tv);
-            if (retval > 0) {
-                int error;
-                socklen_t len = sizeof(error);
-                getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len);
-                if (error == 0) {
-                    std::cout << "Connected to server at " << SERVER_IP << ":" << SERVER_PORT << "\n";
-                    break;
-                }
-            }
-        }
-
-        std::cout << "Connect failed, retrying in 5 seconds\n";
-        close(sockfd);
-        sleep_s(5);
-    }
+    std::cout << "Waiting for commands: 'pickup reached' to turn pump ON, 'drop reached' to turn pump OFF\n";
 
-    if (!keep_running) {
-        std::cout << "Exiting due to signal during connection attempt.\n";
-        // safe shutdown of GPIO
-        set_valve(req, PUMP_OFFSET, ValveState::Off);
-        set_valve(req, VENT_OFFSET, ValveState::Off);
+    std::cout << "Current: OFF\n"; // start OFF
+
+    // ---- Event loop: signals, stdin, robot link and timers ----
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    int sigfd = signalfd(-1, &sigmask, SFD_NONBLOCK | SFD_CLOEXEC);
+    int heartbeat_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int link_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int valve_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int prearm_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epfd < 0 || sigfd < 0 || heartbeat_fd < 0 || link_timer_fd < 0 || valve_timer_fd < 0 || prearm_fd < 0) {
+        std::perror("event loop setup");
+        bank.stage(PUMP_OFFSET, ValveState::Off);
+        bank.stage(VENT_OFFSET, ValveState::Off);
+        bank.commit();
         gpiod_line_request_release(req);
         gpiod_request_config_free(rcfg);
         gpiod_line_config_free(lcfg);
@@ -171,148 +269,340 @@ int main() {
         return 1;
     }
 
-    if (!keep_running) return 1;
+    auto watch = [&](int fd, uint32_t events, Source src) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = static_cast<uint64_t>(src);
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) std::perror("epoll_ctl(ADD)");
+    };
+    auto rewatch = [&](int fd, uint32_t events, Source src) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = static_cast<uint64_t>(src);
+        if (epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) < 0) std::perror("epoll_ctl(MOD)");
+    };
+    watch(sigfd, EPOLLIN, Source::Signal);
+    watch(0, EPOLLIN, Source::Stdin);
+    watch(heartbeat_fd, EPOLLIN, Source::Heartbeat);
+    watch(link_timer_fd, EPOLLIN, Source::LinkTimer);
+    watch(valve_timer_fd, EPOLLIN, Source::Valves);
+    watch(prearm_fd, EPOLLIN, Source::Prearm);
+
+    // Optional vacuum switch; without it every release uses the full vent window.
+    VentSense vent_sense;
+    if (vent_sense_offset >= 0) {
+        if (vent_sense.open(vent_sense_chip, static_cast<unsigned>(vent_sense_offset), vent_sense_active_low,
+                            VENT_SENSE_DEBOUNCE_US)) {
+            watch(vent_sense.fd(), EPOLLIN, Source::VentSense);
+            std::cout << "Vent sense on " << vent_sense_chip << " line " << vent_sense_offset << "\n";
+        } else {
+            std::cout << "Vent sense unavailable, venting for a fixed " << VENT_OPEN_MS << " ms\n";
+        }
+    }
+
+    // ---- Command path: frames to solenoids, vent cycle, pre-arming ----
+    PumpDispatch<ValveBank<2>, VentSense> dispatch(bank, vent_sense, PUMP_OFFSET, VENT_OFFSET, prearm_lead_ms,
+                                                   {valve_timer_fd, prearm_fd, heartbeat_fd}, evlog, tracer, std::cout);
+
+    // ---- Metrics: Prometheus scrape target on --metrics-port, see metrics.h ----
+    // Everything is updated and rendered on this thread; a scrape is one
+    // nonblocking read and write between two events, never a wait.
+    metrics::Registry registry;
+    metrics::LinkMetrics link_metrics;
+    metrics::Counter deliveries;
+    metrics::Gauge link_up_gauge, delivering_gauge, resync_gauge, evlog_dropped_gauge;
+    registry.add_link("nova5_pump_robot", link_metrics);
+    registry.add("nova5_pump_deliveries_total", "Sticker deliveries started.", deliveries);
+    registry.add("nova5_pump_frames_received_total", "Frames received from the robot.", dispatch.stats().frames_in);
+    registry.add("nova5_pump_command_to_gpio_seconds", "Socket readable (epoll wake) to main solenoid written.", dispatch.stats().gpio_latency);
+    registry.add("nova5_pump_vent_open_seconds", "Vent open time per release.", dispatch.stats().vent_open);
+    registry.add("nova5_pump_link_up", "1 while the robot link is up.", link_up_gauge);
+    registry.add("nova5_pump_delivering", "1 while a sticker is being delivered.", delivering_gauge);
+    registry.add("nova5_pump_resync_bytes", "Bytes skipped to find a frame header, this link.", resync_gauge);
+    registry.add("nova5_pump_event_log_dropped", "Event log records lost to a full log.", evlog_dropped_gauge);
+
+    int metrics_fd = -1;
+    int metrics_client = -1; // one scrape at a time; a new one replaces it
+    std::string metrics_request;
+    std::string metrics_reply;   // non-empty: being written, the client waits for EPOLLOUT
+    size_t metrics_sent = 0;
+    if (metrics_port > 0) {
+        metrics_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int one = 1;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(static_cast<uint16_t>(metrics_port));
+        if (metrics_fd < 0 || setsockopt(metrics_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+            bind(metrics_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(metrics_fd, 4) < 0) {
+            std::perror("metrics listener");
+            if (metrics_fd >= 0) close(metrics_fd);
+            metrics_fd = -1;
+        } else {
+            watch(metrics_fd, EPOLLIN, Source::MetricsListen);
+            std::cout << "Metrics on port " << metrics_port << "\n";
+        }
+    }
+
+    bool running = true;
 
-    std::cout << "Waiting for commands: 'pickup reached' to turn pump ON, 'drop reached' to turn pump OFF\n";
+    // ---- Robot link: non-blocking connect, exponential backoff on failure ----
+    enum class Link { Down, Connecting, Up };
+    Link link = Link::Down;
+    link_policy::Backoff backoff;
+
+    using pump_proto::Opcode;
+    pump_proto::FrameRing<> rx;
 
-    auto pump_on = [&]() {
-        set_valve(req, PUMP_OFFSET, ValveState::On); // energize main solenoid
-        std::cout << "[STATE] Pump ON\n";
+    auto send_frame = [&](Opcode op) {
+        if (link != Link::Up) return;
+        uint8_t frame[pump_proto::kMaxFrameSize];
+        const size_t len = pump_proto::encode(op, frame);
+        if (write(sockfd, frame, len) > 0) link_metrics.bytes_out.inc(len);
+        std::cout << "Sent: " << pump_proto::opcode_name(op) << "\n";
     };
 
-    auto pump_off = [&]() {
-        set_valve(req, PUMP_OFFSET, ValveState::Off); // stop main solenoid
-        sleep_ms(50);
-        set_valve(req, VENT_OFFSET, ValveState::On);  // open vent
-        sleep_s(1);
-        set_valve(req, VENT_OFFSET, ValveState::Off); // close vent
-        sleep_ms(50);
-        std::cout << "[STATE] Pump OFF (vented)\n";
+    // Stamped as late as possible so t1 excludes our own send path.
+    auto send_clock_request = [&]() {
+        if (link != Link::Up) return;
+        uint8_t payload[8];
+        uint8_t frame[pump_proto::kMaxFrameSize];
+        pump_proto::put_u64(payload, monotonic_ns());
+        const size_t len = pump_proto::encode(Opcode::ClockRequest, payload, sizeof(payload), frame);
+        if (write(sockfd, frame, len) > 0) link_metrics.bytes_out.inc(len);
     };
 
-    bool is_on = false; // start OFF
-    std::cout << "Current: OFF\n";
-
-    State state = State::WAITING;
-    int send_counter = 0;
-    std::cout << "Waiting for human input (press Enter to start delivering sticker)\n";
-
-    auto reconnect = [&]() -> bool {
-        while (keep_running) {
-            sockfd = socket(AF_INET, SOCK_STREAM, 0);
-            if (sockfd < 0) { std::perror("socket"); return false; }
-
-            fcntl(sockfd, F_SETFL, O_NONBLOCK);
-            int res = connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
-            if (res == 0) {
-                std::cout << "Reconnected to server at " << SERVER_IP << ":" << SERVER_PORT << "\n";
-                state = State::WAITING;
-                send_counter = 0;
-                return true;
-            } else if (errno == EINPROGRESS) {
-                fd_set writefds;
-                FD_ZERO(&writefds);
-                FD_SET(sockfd, &writefds);
-                struct timeval tv = {5, 0};
-                int retval = select(sockfd + 1, NULL, &writefds, NULL, &tv);
-                if (retval > 0) {
-                    int error;
-                    socklen_t len = sizeof(error);
-                    getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len);
-                    if (error == 0) {
-                        std::cout << "Reconnected to server at " << SERVER_IP << ":" << SERVER_PORT << "\n";
-                        state = State::WAITING;
-                        send_counter = 0;
-                        return true;
-                    }
-                }
-            }
-            std::cout << "Reconnect failed, retrying in 5 seconds\n";
+    // failed: a connect attempt failed, rather than an established link dropping.
+    auto schedule_retry = [&](bool failed = true) {
+        if (failed) link_metrics.connect_failures.inc();
+        const int delay = backoff.next_ms();
+        std::cout << "Connect failed, retrying in " << delay << " ms\n";
+        link = Link::Down;
+        arm_timer(link_timer_fd, delay, 0);
+    };
+
+    auto link_up = [&]() {
+        link = Link::Up;
+        arm_timer(link_timer_fd, 0, 0);
+        rewatch(sockfd, EPOLLIN, Source::Socket);
+        if (!link_policy::tune_socket(sockfd)) std::perror("setsockopt(keepalive)");
+        backoff.reset();
+        std::cout << "Connected to server at " << server_ip << ":" << server_port << "\n";
+        send_clock_request();
+        dispatch.enter_waiting();
+        std::cout << "Waiting for human input (press Enter to start delivering sticker)\n";
+    };
+
+    auto start_connect = [&]() {
+        link_metrics.connect_attempts.inc();
+        sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sockfd < 0) { std::perror("socket"); schedule_retry(); return; }
+
+        int res = connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+        if (res < 0 && errno != EINPROGRESS) {
             close(sockfd);
-            sleep_s(5);
+            sockfd = -1;
+            schedule_retry();
+            return;
         }
-        return false;
+        link = Link::Connecting;
+        watch(sockfd, EPOLLOUT, Source::Socket);
+        if (res == 0) { link_up(); return; }
+        arm_timer(link_timer_fd, link_policy::kConnectTimeoutMs, 0);
     };
 
-    while (keep_running) {
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(sockfd, &readfds);
-        FD_SET(0, &readfds); // stdin
-        struct timeval tv = {1, 0};
-        int maxfd = std::max(sockfd, 0) + 1;
+    auto drop_link = [&]() {
+        if (sockfd >= 0) close(sockfd); // also removes it from the epoll set
+        sockfd = -1;
+        rx.clear(); // a partial frame from the old link must not prefix the new stream
+        dispatch.link_dropped();
+        link_metrics.link_drops.inc();
+        schedule_retry(false);
+    };
 
-        int retval = select(maxfd, &readfds, NULL, NULL, &tv);
-        if (retval == -1) {
-            if (errno == EINTR) continue;
-            std::perror("select, reconnecting");
-            close(sockfd);
-            if (!reconnect()) break;
-            continue;
-        } else if (retval == 0) {
-            // timeout
-            if (state == State::WAITING) {
-                send_counter++;
-                if (send_counter >= 10) {
-                    const char* msg = "wait until next sticker\n";
-                    (void)write(sockfd, msg, strlen(msg));
-                    std::cout << "Sent: wait until next sticker\n";
-                    send_counter = 0;
-                }
+    auto on_socket = [&](uint32_t events, uint64_t wake_ns) {
+        // The connect timeout earlier in the same epoll batch may have closed it.
+        if (sockfd < 0) return;
+        if (link == Link::Connecting) {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len);
+            if (error == 0 && !(events & EPOLLERR)) {
+                link_up();
+            } else {
+                close(sockfd);
+                sockfd = -1;
+                schedule_retry();
             }
+            return;
+        }
+
+        size_t space;
+        uint8_t* dst = rx.write_region(space);
+        ssize_t n = read(sockfd, dst, space);
+        const uint64_t rx_ns = monotonic_ns();
+
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        if (n <= 0) {
+            if (n == 0) std::cout << "Server closed connection, reconnecting...\n";
+            else std::perror("read, reconnecting");
+            drop_link();
+            return;
+        }
+        rx.commit(static_cast<size_t>(n));
+        link_metrics.bytes_in.inc(static_cast<uint64_t>(n));
+
+        dispatch.drain(rx, wake_ns, rx_ns);
+    };
+
+    auto on_stdin = [&]() {
+        char buf[256];
+        ssize_t n = read(0, buf, sizeof(buf));
+        if (n <= 0) {
+            if (n == 0) epoll_ctl(epfd, EPOLL_CTL_DEL, 0, nullptr); // stdin closed
+            return;
+        }
+        if (!std::memchr(buf, '\n', static_cast<size_t>(n))) return;
+        if (link != Link::Up) {
+            std::cout << "Not connected to server yet\n";
+        } else if (dispatch.state() == State::WAITING) {
+            send_frame(Opcode::DeliverSticker);
+            evlog.append(event_log::Kind::DeliverSent);
+            deliveries.inc();
+            dispatch.start_delivery();
+            std::cout << "Started delivering sticker\n";
+        }
+    };
+
+    auto on_metrics_accept = [&]() {
+        const int fd = accept4(metrics_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (metrics_client >= 0) close(metrics_client);
+        metrics_client = fd;
+        metrics_request.clear();
+        metrics_reply.clear();
+        watch(fd, EPOLLIN, Source::MetricsClient);
+    };
+
+    auto close_metrics_client = [&]() {
+        close(metrics_client);
+        metrics_client = -1;
+        metrics_reply.clear();
+    };
+
+    // Writes as much of the reply as the socket takes; true once all of it is out.
+    auto send_metrics_reply = [&]() {
+        while (metrics_sent < metrics_reply.size()) {
+            const ssize_t n = send(metrics_client, metrics_reply.data() + metrics_sent, metrics_reply.size() - metrics_sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) return false;
+            if (n <= 0) break; // scraper went away
+            metrics_sent += static_cast<size_t>(n);
+        }
+        return true;
+    };
+
+    auto on_metrics_client = [&]() {
+        if (!metrics_reply.empty()) {
+            if (send_metrics_reply()) close_metrics_client();
+            return;
+        }
+        char buf[1024];
+        const ssize_t n = read(metrics_client, buf, sizeof(buf));
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        if (n > 0) metrics_request.append(buf, static_cast<size_t>(n));
+        link_up_gauge.set(link == Link::Up);
+        delivering_gauge.set(dispatch.state() == State::DELIVERING);
+        resync_gauge.set(static_cast<int64_t>(rx.resync_bytes()));
+        evlog_dropped_gauge.set(static_cast<int64_t>(evlog.dropped()));
+        metrics_reply = metrics::http_response(metrics_request.data(), metrics_request.size(), registry);
+        if (n > 0 && metrics_reply.empty()) return; // request header not complete yet
+        metrics_sent = 0;
+        // A truncated exposition is a parse error for the scraper, so a reply
+        // larger than the socket buffer is finished on EPOLLOUT.
+        if (send_metrics_reply()) {
+            close_metrics_client();
         } else {
-            if (FD_ISSET(0, &readfds)) {
-                char c;
-                read(0, &c, 1);
-                if (c == '\n' && state == State::WAITING) {
-                    const char* msg = "deliver a new sticker\n";
-                    (void)write(sockfd, msg, strlen(msg));
-                    state = State::DELIVERING;
-                    std::cout << "Started delivering sticker\n";
-                }
-            }
+            rewatch(metrics_client, EPOLLOUT, Source::MetricsClient);
+        }
+    };
 
-            if (FD_ISSET(sockfd, &readfds)) {
-                char buffer[256];
-                memset(buffer, 0, sizeof(buffer));
-                int n = read(sockfd, buffer, sizeof(buffer) - 1);
-
-                if (n <= 0) {
-                    if (n == 0) std::cout << "Server closed connection, reconnecting...\n";
-                    else std::perror("read, reconnecting");
-                    close(sockfd);
-                    if (!reconnect()) break;
-                    continue;
-                }
+    std::cout << "Attempting to connect to server at " << server_ip << ":" << server_port << "\n";
+    start_connect();
 
-                std::string cmd(buffer);
-                std::cout << "Received: " << cmd << std::endl;
-
-                if (state == State::DELIVERING) {
-                    if (cmd.find("pickup reached") != std::string::npos) {
-                        if (!is_on) { pump_on(); is_on = true; }
-                    } else if (cmd.find("drop reached") != std::string::npos) {
-                        if (is_on) { pump_off(); is_on = false; }
-                    } else if (cmd.find("one sticker finished") != std::string::npos) {
-                        state = State::WAITING;
-                        std::cout << "Sticker finished, waiting for next\n";
-                    }
+    epoll_event events[8];
+    while (running) {
+        int nev = epoll_wait(epfd, events, 8, -1);
+        if (nev < 0) {
+            if (errno == EINTR) continue;
+            std::perror("epoll_wait");
+            break;
+        }
+        const uint64_t wake_ns = monotonic_ns();
+        for (int i = 0; i < nev && running; ++i) {
+            uint64_t expirations;
+            switch (static_cast<Source>(events[i].data.u64)) {
+                case Source::Signal: {
+                    signalfd_siginfo si;
+                    (void)read(sigfd, &si, sizeof(si));
+                    running = false;
+                    break;
                 }
+                case Source::Stdin:
+                    on_stdin();
+                    break;
+                case Source::Socket:
+                    on_socket(events[i].events, wake_ns);
+                    break;
+                case Source::Heartbeat:
+                    (void)read(heartbeat_fd, &expirations, sizeof(expirations));
+                    if (dispatch.state() == State::WAITING) send_frame(Opcode::WaitNextSticker);
+                    send_clock_request(); // follows drift between the two clocks
+                    break;
+                case Source::Valves:
+                    (void)read(valve_timer_fd, &expirations, sizeof(expirations));
+                    dispatch.run_valves();
+                    break;
+                case Source::Prearm:
+                    (void)read(prearm_fd, &expirations, sizeof(expirations));
+                    dispatch.on_prearm_timer();
+                    break;
+                case Source::VentSense:
+                    vent_sense.read([&](uint64_t ts_ns) { dispatch.on_vent_edge(ts_ns); });
+                    break;
+                case Source::MetricsListen:
+                    on_metrics_accept();
+                    break;
+                case Source::MetricsClient:
+                    if (metrics_client >= 0) on_metrics_client();
+                    break;
+                case Source::LinkTimer:
+                    (void)read(link_timer_fd, &expirations, sizeof(expirations));
+                    if (link == Link::Connecting) {
+                        close(sockfd); // connect timed out
+                        sockfd = -1;
+                        schedule_retry();
+                    } else if (link == Link::Down) {
+                        start_connect();
+                    }
+                    break;
             }
         }
     }
 
-    // Close socket
-    close(sockfd);
+    // Close socket and event sources
+    if (sockfd >= 0) close(sockfd);
+    if (metrics_client >= 0) close(metrics_client);
+    if (metrics_fd >= 0) close(metrics_fd);
+    close(link_timer_fd);
+    close(prearm_fd);
+    close(heartbeat_fd);
+    close(sigfd);
+    close(epfd);
 
-    // Ensure safe shutdown state
-    if (is_on) {
-        pump_off();
-        is_on = false;
-    } else {
-        set_valve(req, PUMP_OFFSET, ValveState::Off);
-        set_valve(req, VENT_OFFSET, ValveState::Off);
-    }
+    // Ensure safe shutdown state: finish any release cycle synchronously
+    dispatch.shutdown();
+    close(valve_timer_fd);
 
     // ---- libgpiod v2 cleanup ----
     gpiod_line_request_release(req);
@@ -321,6 +611,26 @@ int main() {
     gpiod_line_settings_free(settings);
     gpiod_chip_close(chip);
 
+    const auto& stats = dispatch.stats();
+    if (stats.cmd_to_gpio.count() > 0) {
+        std::cout.flush();
+        stats.cmd_to_gpio.print(stdout, "Command-to-GPIO latency:");
+    }
+    if (stats.prearm_saved.count() > 0) stats.prearm_saved.print(stdout, "Pre-arm vacuum time saved per pickup:");
+    if (stats.vent_time.count() > 0) stats.vent_time.print(stdout, "Vent open time per release:");
+    if (trace_path) {
+        static trace::Record records[decltype(tracer)::capacity()];
+        const size_t n = tracer.snapshot(records, tracer.capacity());
+        if (trace::write_file(trace_path, records, n)) std::cout << "Trace written to " << trace_path << "\n";
+        trace::report(stdout, records, n);
+    }
+
+    if (evlog.is_open()) {
+        if (evlog.dropped() > 0) std::cout << "Event log full, " << evlog.dropped() << " events dropped\n";
+        evlog.close();
+        std::cout << "Events written to " << events_path << "\n";
+    }
+
     std::cout << "Exited.\n";
     return 0;
 }
@@ -0,0 +1,401 @@
+#ifndef PUMP_DISPATCH_H
+#define PUMP_DISPATCH_H
+
+#include <sys/timerfd.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <ostream>
+
+#include "../common/event_log.h"
+#include "../common/metrics.h"
+#include "latency_histogram.h"
+#include "pump_protocol.h"
+#include "trace_ring.h"
+#include "valve_sequencer.h"
+
+// pump_control's command path: from the frames read off the robot link to the
+// solenoids, including the timed vent cycle and pre-arming. pump_control's
+// event loop owns the fds and calls in here; bench/bench_pump.cpp drives the
+// same code. Bank is a ValveBank (stage/commit/set/state) and Sense a
+// VentSense (is_open/ambient): the two parts that need the GPIO chip, and the
+// only ones the benchmark replaces.
+
+// Release sequence: main solenoid off, vent opens after VENT_DELAY_MS for VENT_OPEN_MS.
+// With a vacuum switch (--vent-sense) the vent closes as soon as the switch
+// reports ambient pressure; VENT_OPEN_MS is then only the upper bound.
+static constexpr uint64_t VENT_DELAY_MS = 50;
+static constexpr uint64_t VENT_OPEN_MS = 1000;
+
+// Pre-arming (--prearm-lead MS): on "approaching pickup" the pump is switched
+// on lead ms before the announced arrival, so vacuum is built up when the tool
+// gets there. A pump pre-armed for a pickup that never comes is switched off
+// again PREARM_TIMEOUT_MS after the ETA.
+static constexpr uint64_t PREARM_TIMEOUT_MS = 3000;
+
+// Heartbeat towards the robot while no sticker is being delivered.
+static constexpr int HEARTBEAT_MS = 10000;
+
+// Arms a timerfd: first expiry after first_ms, then every interval_ms (0 = one-shot, first_ms 0 = disarm).
+static inline void arm_timer(int fd, int first_ms, int interval_ms) {
+    itimerspec its{};
+    its.it_value.tv_sec = first_ms / 1000;
+    its.it_value.tv_nsec = (first_ms % 1000) * 1000000L;
+    its.it_interval.tv_sec = interval_ms / 1000;
+    its.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+    if (timerfd_settime(fd, 0, &its, nullptr) < 0) std::perror("timerfd_settime");
+}
+
+// Arms a timerfd to fire once at an absolute CLOCK_MONOTONIC time (0 = disarm).
+static inline void arm_timer_at(int fd, uint64_t due_ns) {
+    itimerspec its{};
+    its.it_value.tv_sec = static_cast<time_t>(due_ns / 1000000000ull);
+    its.it_value.tv_nsec = static_cast<long>(due_ns % 1000000000ull);
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, nullptr) < 0) std::perror("timerfd_settime");
+}
+
+enum class State { WAITING, DELIVERING };
+
+template <typename Bank, typename Sense>
+class PumpDispatch {
+public:
+    // timerfds owned by the caller: the vent cycle, pre-arming and the heartbeat.
+    struct Timers {
+        int valves;
+        int prearm;
+        int heartbeat;
+    };
+
+    // Printed at exit, and exported on --metrics-port.
+    struct Stats {
+        LatencyHistogram cmd_to_gpio;  // epoll wake for the socket -> main solenoid written, pickup and drop
+        LatencyHistogram prearm_saved; // vacuum time gained per pickup by pre-arming, capped at the lead
+        LatencyHistogram vent_time;    // vent open -> closed, per release
+        metrics::Counter frames_in;
+        metrics::Histogram gpio_latency = metrics::gpio_latency_histogram();
+        metrics::Histogram vent_open = metrics::vent_histogram();
+    };
+
+    PumpDispatch(Bank& bank, const Sense& vent_sense, unsigned pump_offset, unsigned vent_offset,
+                 uint64_t prearm_lead_ms, Timers timers, event_log::EventLog& evlog, trace::TraceRing<>& tracer,
+                 std::ostream& out)
+        : bank_(bank),
+          vent_sense_(vent_sense),
+          pump_offset_(pump_offset),
+          vent_offset_(vent_offset),
+          prearm_lead_ns_(ms_to_ns(prearm_lead_ms)),
+          timers_(timers),
+          evlog_(evlog),
+          tracer_(tracer),
+          out_(out) {}
+
+    State state() const { return state_; }
+    bool is_on() const { return is_on_; }
+    Stats& stats() { return stats_; }
+    const Stats& stats() const { return stats_; }
+
+    // A DeliverSticker went out.
+    void start_delivery() {
+        state_ = State::DELIVERING;
+        arm_timer(timers_.heartbeat, 0, 0);
+    }
+
+    void enter_waiting() {
+        state_ = State::WAITING;
+        arm_timer(timers_.heartbeat, HEARTBEAT_MS, HEARTBEAT_MS);
+    }
+
+    // The robot link went down; a delivery in progress is abandoned.
+    void link_dropped() {
+        have_offset_ = false; // the robot may have restarted with a new clock
+        prearm_cancel();
+        arm_timer(timers_.heartbeat, 0, 0);
+        state_ = State::WAITING;
+    }
+
+    // Dispatches every complete frame in rx. wake_ns: epoll reported the
+    // socket readable, the start of the command-to-GPIO latency; rx_ns: the
+    // read that brought the bytes returned, the arrival time of each frame.
+    void drain(pump_proto::FrameRing<>& rx, uint64_t wake_ns, uint64_t rx_ns) {
+        using pump_proto::Opcode;
+        pump_proto::Frame frame;
+        while (rx.pop(frame)) {
+            stats_.frames_in.inc();
+            const uint32_t ev = ++event_seq_;
+            const uint8_t op = static_cast<uint8_t>(frame.opcode);
+            tracer_.record(ev, trace::SocketReadable, op, wake_ns);
+            tracer_.record(ev, trace::FrameParsed, op, monotonic_ns());
+
+            if (frame.opcode == Opcode::ClockReply) {
+                on_clock_reply(frame, rx_ns);
+                continue;
+            }
+
+            // Act first, log afterwards: console output stays off the command path.
+            if (state_ == State::DELIVERING) {
+                switch (frame.opcode) {
+                    case Opcode::ApproachingPickup:
+                        on_approaching(frame, rx_ns);
+                        break;
+                    case Opcode::PickupReached:
+                        if (prearm_ == Prearm::Scheduled) {
+                            arm_timer_at(timers_.prearm, 0); // arrived ahead of its ETA
+                            prearm_ = Prearm::Idle;
+                        }
+                        if (!is_on_) {
+                            tracer_.record(ev, trace::StateTransition, op, monotonic_ns());
+                            const uint64_t done = pump_on();
+                            tracer_.record(ev, trace::GpioDone, op, done);
+                            stats_.cmd_to_gpio.record(done - wake_ns);
+                            stats_.gpio_latency.observe_ns(done - wake_ns);
+                            is_on_ = true;
+                            if (prearm_lead_ns_ > 0) stats_.prearm_saved.record(0);
+                        } else if (prearm_ == Prearm::On) {
+                            arm_timer_at(timers_.prearm, 0);
+                            prearm_ = Prearm::Idle;
+                            const uint64_t saved = std::min(rx_ns - prearm_on_ns_, prearm_lead_ns_);
+                            stats_.prearm_saved.record(saved);
+                            out_ << "Vacuum ready " << saved / 1000000 << " ms ahead of pickup\n";
+                        }
+                        break;
+                    case Opcode::DropReached:
+                        if (is_on_) {
+                            tracer_.record(ev, trace::StateTransition, op, monotonic_ns());
+                            const uint64_t done = pump_off();
+                            tracer_.record(ev, trace::GpioDone, op, done);
+                            stats_.cmd_to_gpio.record(done - wake_ns);
+                            stats_.gpio_latency.observe_ns(done - wake_ns);
+                            is_on_ = false;
+                        }
+                        break;
+                    case Opcode::StickerFinished:
+                        tracer_.record(ev, trace::StateTransition, op, monotonic_ns());
+                        prearm_cancel();
+                        enter_waiting();
+                        out_ << "Sticker finished, waiting for next\n";
+                        break;
+                    default:
+                        break;
+                }
+            }
+            switch (frame.opcode) {
+                case Opcode::ApproachingPickup:
+                    evlog_.append(event_log::Kind::ApproachingPickup, robot_time(frame),
+                                  frame.length >= 12 ? pump_proto::get_u32(frame.payload + 8) : -1, rx_ns);
+                    break;
+                case Opcode::PickupReached:
+                    evlog_.append(event_log::Kind::PickupReached, robot_time(frame), 0, rx_ns);
+                    break;
+                case Opcode::DropReached:
+                    evlog_.append(event_log::Kind::DropReached, robot_time(frame), 0, rx_ns);
+                    break;
+                case Opcode::StickerFinished:
+                    evlog_.append(event_log::Kind::StickerFinished, robot_time(frame), 0, rx_ns);
+                    break;
+                default:
+                    break;
+            }
+            out_ << "Received: " << pump_proto::opcode_name(frame.opcode) << "\n";
+        }
+    }
+
+    // Applies the valve steps due at now_ns; steps due together are staged
+    // and committed as one write.
+    void apply_due(uint64_t now_ns) {
+        bool vented = false;
+        bool vent_opened = false;
+        typename ValveSequencer<>::Step applied[16];
+        size_t n = 0;
+        valves_.run_due(now_ns, [&](const typename ValveSequencer<>::Step& step) {
+            bank_.stage(step.offset, step.state);
+            vented |= (step.offset == vent_offset_ && step.state == ValveState::Off);
+            vent_opened |= (step.offset == vent_offset_ && step.state == ValveState::On);
+            if (n < 16) applied[n++] = step;
+        });
+        bank_.commit();
+        const uint64_t done = monotonic_ns();
+        for (size_t i = 0; i < n; ++i) {
+            evlog_.append(event_log::Kind::ValveChange, applied[i].offset, applied[i].state == ValveState::On, done);
+        }
+        if (vent_opened) {
+            vent_opened_ns_ = done;
+            // Already ambient before the vent opened (a leaky or light object):
+            // no edge will come, close right away.
+            if (vent_sense_.is_open() && vent_sense_.ambient()) {
+                close_vent(done);
+                return;
+            }
+        }
+        if (vented) {
+            stats_.vent_time.record(done - vent_opened_ns_);
+            stats_.vent_open.observe_ns(done - vent_opened_ns_);
+            out_ << "[STATE] Pump OFF (vented" << (vent_sense_.is_open() ? ", no ambient edge" : "") << ")\n";
+        }
+    }
+
+    // The valve timerfd expired.
+    void run_valves() {
+        apply_due(monotonic_ns());
+        arm_timer_at(timers_.valves, valves_.next_due());
+    }
+
+    // The vacuum switch reported ambient pressure at ts_ns.
+    void on_vent_edge(uint64_t ts_ns) {
+        // Only an open vent is cut short; edges at other times are
+        // the switch settling after pickup or the fallback close.
+        if (bank_.state(vent_offset_) == ValveState::On) close_vent(ts_ns);
+    }
+
+    // The pre-arm timerfd expired.
+    void on_prearm_timer() {
+        if (prearm_ == Prearm::Scheduled) {
+            prearm_fire();
+        } else if (prearm_ == Prearm::On) {
+            out_ << "Pre-armed pickup never arrived, pump off\n";
+            prearm_cancel();
+        }
+    }
+
+    // Safe shutdown state: finishes any release cycle synchronously, then
+    // leaves both valves off.
+    void shutdown() {
+        if (is_on_) {
+            pump_off();
+            is_on_ = false;
+        }
+        while (!valves_.idle()) {
+            const uint64_t due = valves_.next_due();
+            timespec ts{static_cast<time_t>(due / 1000000000ull), static_cast<long>(due % 1000000000ull)};
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+            apply_due(monotonic_ns());
+        }
+        bank_.stage(pump_offset_, ValveState::Off);
+        bank_.stage(vent_offset_, ValveState::Off);
+        bank_.commit();
+    }
+
+private:
+    enum class Prearm { Idle, Scheduled, On };
+
+    void close_vent(uint64_t ambient_ns) {
+        valves_.cancel(); // drops the fallback close
+        arm_timer_at(timers_.valves, 0);
+        bank_.set(vent_offset_, ValveState::Off);
+        const uint64_t done = monotonic_ns();
+        const uint64_t open_ns = ambient_ns > vent_opened_ns_ ? ambient_ns - vent_opened_ns_ : 0;
+        stats_.vent_time.record(done - vent_opened_ns_);
+        stats_.vent_open.observe_ns(done - vent_opened_ns_);
+        evlog_.append(event_log::Kind::AmbientReached, 0, static_cast<int64_t>(open_ns), ambient_ns);
+        evlog_.append(event_log::Kind::ValveChange, vent_offset_, 0, done);
+        out_ << "[STATE] Pump OFF (ambient after " << open_ns / 1000000 << " ms)\n";
+    }
+
+    // pump_on/pump_off return the time their GPIO write completed.
+    uint64_t pump_on() {
+        bool preempted = false;
+        if (!valves_.idle()) {
+            // A pickup arriving mid-vent wins: close the vent now instead of
+            // letting the rest of the release cycle delay the new sticker.
+            valves_.cancel();
+            arm_timer_at(timers_.valves, 0);
+            bank_.stage(vent_offset_, ValveState::Off);
+            preempted = true;
+        }
+        bank_.stage(pump_offset_, ValveState::On); // energize main solenoid
+        bank_.commit();
+        const uint64_t done = monotonic_ns();
+        if (preempted) evlog_.append(event_log::Kind::ValveChange, vent_offset_, 0, done);
+        evlog_.append(event_log::Kind::ValveChange, pump_offset_, 1, done);
+        if (preempted) out_ << "[STATE] Vent cycle preempted\n";
+        out_ << "[STATE] Pump ON\n";
+        return done;
+    }
+
+    uint64_t pump_off() {
+        const uint64_t now = monotonic_ns();
+        bank_.set(pump_offset_, ValveState::Off); // stop main solenoid
+        const uint64_t done = monotonic_ns();
+        evlog_.append(event_log::Kind::ValveChange, pump_offset_, 0, done);
+        valves_.schedule(now + ms_to_ns(VENT_DELAY_MS), vent_offset_, ValveState::On);                 // open vent
+        valves_.schedule(now + ms_to_ns(VENT_DELAY_MS + VENT_OPEN_MS), vent_offset_, ValveState::Off); // close vent
+        arm_timer_at(timers_.valves, valves_.next_due());
+        out_ << "[STATE] Pump OFF, venting\n";
+        return done;
+    }
+
+    void prearm_fire() {
+        prearm_on_ns_ = pump_on();
+        is_on_ = true;
+        prearm_ = Prearm::On;
+        arm_timer_at(timers_.prearm, prearm_expiry_ns_);
+        out_ << "[STATE] Pump pre-armed\n";
+    }
+
+    // Drops a pending or active pre-arm; a pump that was only pre-armed goes off.
+    void prearm_cancel() {
+        if (prearm_ == Prearm::On && is_on_) {
+            pump_off();
+            is_on_ = false;
+        }
+        if (prearm_ != Prearm::Idle) arm_timer_at(timers_.prearm, 0);
+        prearm_ = Prearm::Idle;
+    }
+
+    void on_approaching(const pump_proto::Frame& frame, uint64_t rx_ns) {
+        if (prearm_lead_ns_ == 0 || is_on_ || frame.length < 12) return;
+        const uint64_t eta_ns = rx_ns + ms_to_ns(pump_proto::get_u32(frame.payload + 8));
+        prearm_expiry_ns_ = eta_ns + ms_to_ns(PREARM_TIMEOUT_MS);
+        if (eta_ns <= rx_ns + prearm_lead_ns_) {
+            prearm_fire(); // announced too late for the full lead
+        } else {
+            prearm_ = Prearm::Scheduled;
+            arm_timer_at(timers_.prearm, eta_ns - prearm_lead_ns_);
+        }
+    }
+
+    void on_clock_reply(const pump_proto::Frame& frame, uint64_t t4) {
+        if (frame.length < 24) return;
+        const uint64_t t1 = pump_proto::get_u64(frame.payload);
+        const uint64_t t2 = pump_proto::get_u64(frame.payload + 8);
+        const uint64_t t3 = pump_proto::get_u64(frame.payload + 16);
+        robot_offset_ns_ = event_log::clock_offset(t1, t2, t3, t4);
+        have_offset_ = true;
+        evlog_.append(event_log::Kind::ClockSync, robot_offset_ns_, event_log::round_trip(t1, t2, t3, t4), t4);
+    }
+
+    // Robot timestamp carried by a frame, moved onto our clock; -1 if there is none.
+    int64_t robot_time(const pump_proto::Frame& frame) const {
+        if (!have_offset_ || frame.length < 8) return -1;
+        return static_cast<int64_t>(pump_proto::get_u64(frame.payload)) - robot_offset_ns_;
+    }
+
+    Bank& bank_;
+    const Sense& vent_sense_;
+    const unsigned pump_offset_;
+    const unsigned vent_offset_;
+    const uint64_t prearm_lead_ns_;
+    const Timers timers_;
+    event_log::EventLog& evlog_;
+    trace::TraceRing<>& tracer_;
+    std::ostream& out_;
+
+    State state_ = State::WAITING;
+    bool is_on_ = false;
+    ValveSequencer<> valves_;
+    uint64_t vent_opened_ns_ = 0;
+
+    Prearm prearm_ = Prearm::Idle;
+    uint64_t prearm_on_ns_ = 0;
+    uint64_t prearm_expiry_ns_ = 0;
+
+    // Robot clock minus ours, from the latest ClockRequest/ClockReply exchange.
+    bool have_offset_ = false;
+    int64_t robot_offset_ns_ = 0;
+
+    uint32_t event_seq_ = 0;
+    Stats stats_;
+};
+
+#endif // PUMP_DISPATCH_H
@@ -1,6 +1,56 @@
 import socket
+import struct
 import time
 
+# Framed protocol shared with pump_control.cpp (see pump_protocol.h):
+# magic(0xA5), opcode, payload length (u16 little endian), payload
+MAGIC = 0xA5
+HEADER = struct.Struct('<BBH')
+U64 = struct.Struct('<Q')
+APPROACH_PAYLOAD = struct.Struct('<QI')
+CLOCK_REPLY_PAYLOAD = struct.Struct('<QQQ')
+
+PICKUP_REACHED = 0x01
+DROP_REACHED = 0x02
+STICKER_FINISHED = 0x03
+CLOCK_REPLY = 0x04
+APPROACHING_PICKUP = 0x05
+DELIVER_STICKER = 0x81
+WAIT_NEXT_STICKER = 0x82
+CLOCK_REQUEST = 0x83
+
+NAMES = {
+    PICKUP_REACHED: "pickup reached",
+    DROP_REACHED: "drop reached",
+    STICKER_FINISHED: "one sticker finished",
+    CLOCK_REPLY: "clock reply",
+    APPROACHING_PICKUP: "approaching pickup",
+    DELIVER_STICKER: "deliver a new sticker",
+    WAIT_NEXT_STICKER: "wait until next sticker",
+    CLOCK_REQUEST: "clock request",
+}
+
+def send_frame(conn, opcode, payload=b''):
+    conn.sendall(HEADER.pack(MAGIC, opcode, len(payload)) + payload)
+    print(f"Sent: {NAMES.get(opcode, hex(opcode))}")
+
+def send_stamped(conn, opcode):
+    # Robot frames lead with the robot's own clock (see pump_protocol.h).
+    send_frame(conn, opcode, U64.pack(time.monotonic_ns()))
+
+def pop_frames(buffer):
+    frames = []
+    while len(buffer) >= HEADER.size:
+        magic, opcode, length = HEADER.unpack_from(buffer)
+        if magic != MAGIC:
+            del buffer[0]
+            continue
+        if len(buffer) < HEADER.size + length:
+            break
+        frames.append((opcode, bytes(buffer[HEADER.size:HEADER.size + length])))
+        del buffer[:HEADER.size + length]
+    return frames
+
 def start_server(host='192.168.0.152', port=8888):
     # Create a TCP/IP socket
     server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
@@ -12,32 +62,36 @@ def start_server(host='192.168.0.152', port=8888):
     conn, addr = server_socket.accept()
     print(f"Connected by {addr}")
 
-    buffer = ""
+    buffer = bytearray()
     try:
         while True:
             data = conn.recv(1024)
             if not data:
                 print("Client disconnected.")
                 break
-            buffer += data.decode('utf-8')
-            while '\n' in buffer:
-                message, buffer = buffer.split('\n', 1)
-                message = message.strip()
-                print(f"Received: {message}")
-                if message == "deliver a new sticker":
+            buffer += data
+            for opcode, payload in pop_frames(buffer):
+                if opcode == CLOCK_REQUEST and len(payload) >= 8:
+                    received = time.monotonic_ns()
+                    reply = CLOCK_REPLY_PAYLOAD.pack(U64.unpack_from(payload)[0], received, time.monotonic_ns())
+                    conn.sendall(HEADER.pack(MAGIC, CLOCK_REPLY, len(reply)) + reply)
+                    continue
+                print(f"Received: {NAMES.get(opcode, hex(opcode))}")
+                if opcode == DELIVER_STICKER:
                     print("Starting sticker delivery sequence...")
-                    conn.sendall(b"pickup reached\n")
-                    print("Sent: pickup reached")
+                    # Announce the pickup so a --prearm-lead controller can start early.
+                    eta_ms = 500
+                    send_frame(conn, APPROACHING_PICKUP, APPROACH_PAYLOAD.pack(time.monotonic_ns(), eta_ms))
+                    time.sleep(eta_ms / 1000)
+                    send_stamped(conn, PICKUP_REACHED)
                     time.sleep(2)
-                    conn.sendall(b"drop reached\n")
-                    print("Sent: drop reached")
+                    send_stamped(conn, DROP_REACHED)
                     time.sleep(2)
-                    conn.sendall(b"one sticker finished\n")
-                    print("Sent: one sticker finished")
-                elif message == "wait until next sticker":
+                    send_stamped(conn, STICKER_FINISHED)
+                elif opcode == WAIT_NEXT_STICKER:
                     print("Waiting for next sticker...")
                 else:
-                    print(f"Unknown message: {message}")
+                    print(f"Unknown message: {opcode:#x}")
     except KeyboardInterrupt:
         print("Server stopped manually.")
     finally:
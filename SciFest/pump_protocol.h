@@ -0,0 +1,141 @@
+#ifndef PUMP_PROTOCOL_H
+#define PUMP_PROTOCOL_H
+
+// Framed binary protocol between the robot and the pump controller.
+//
+//   byte 0     magic (0xA5)
+//   byte 1     opcode
+//   byte 2..3  payload length, little endian (0..kMaxPayload)
+//   byte 4..   payload
+//
+// Frames are reassembled in a fixed ring buffer, so several frames arriving in
+// one read() or one frame split across reads are both handled without
+// rescanning. A corrupt header is skipped one byte at a time until the next magic.
+//
+// Robot frames may carry the robot's clock (u64 ns, little endian) as their
+// first payload bytes; ClockRequest/ClockReply relate that clock to ours.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace pump_proto {
+
+static constexpr uint8_t kMagic = 0xA5;
+static constexpr size_t kHeaderSize = 4;
+static constexpr size_t kMaxPayload = 32;
+static constexpr size_t kMaxFrameSize = kHeaderSize + kMaxPayload;
+
+enum class Opcode : uint8_t {
+    // robot -> pump controller
+    PickupReached   = 0x01,
+    DropReached     = 0x02,
+    StickerFinished = 0x03,
+    ClockReply      = 0x04, // payload: t1 echoed, t2 robot receive, t3 robot send (u64 ns each)
+    ApproachingPickup = 0x05, // payload: robot clock (u64 ns), ETA at the pickup pose (u32 ms)
+    // pump controller -> robot
+    DeliverSticker  = 0x81,
+    WaitNextSticker = 0x82,
+    ClockRequest    = 0x83, // payload: t1, our CLOCK_MONOTONIC at send (u64 ns)
+};
+
+inline const char* opcode_name(Opcode op) {
+    switch (op) {
+        case Opcode::PickupReached:   return "pickup reached";
+        case Opcode::DropReached:     return "drop reached";
+        case Opcode::StickerFinished: return "one sticker finished";
+        case Opcode::ClockReply:      return "clock reply";
+        case Opcode::ApproachingPickup: return "approaching pickup";
+        case Opcode::DeliverSticker:  return "deliver a new sticker";
+        case Opcode::WaitNextSticker: return "wait until next sticker";
+        case Opcode::ClockRequest:    return "clock request";
+    }
+    return "unknown";
+}
+
+struct Frame {
+    Opcode opcode;
+    uint16_t length;
+    uint8_t payload[kMaxPayload];
+};
+
+// Writes one frame into out (at least kHeaderSize + len bytes) and returns its size.
+inline size_t encode(Opcode op, const void* payload, uint16_t len, uint8_t* out) {
+    if (len > kMaxPayload) len = kMaxPayload;
+    out[0] = kMagic;
+    out[1] = static_cast<uint8_t>(op);
+    out[2] = static_cast<uint8_t>(len & 0xFF);
+    out[3] = static_cast<uint8_t>(len >> 8);
+    if (len > 0) std::memcpy(out + kHeaderSize, payload, len);
+    return kHeaderSize + len;
+}
+
+inline size_t encode(Opcode op, uint8_t* out) { return encode(op, nullptr, 0, out); }
+
+inline void put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+inline uint32_t get_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+// Single-producer byte ring. read() goes straight into write_region(), frames
+// come out of pop(); Capacity must be a power of two.
+template <size_t Capacity = 1024>
+class FrameRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(Capacity >= 2 * kMaxFrameSize, "Capacity too small for a frame");
+
+public:
+    // Contiguous free space starting at the write position.
+    uint8_t* write_region(size_t& space) {
+        const size_t used = head_ - tail_;
+        const size_t pos = head_ & (Capacity - 1);
+        space = Capacity - used;
+        if (space > Capacity - pos) space = Capacity - pos;
+        return buf_ + pos;
+    }
+    void commit(size_t n) { head_ += n; }
+
+    size_t size() const { return head_ - tail_; }
+    size_t resync_bytes() const { return resync_; }
+    void clear() { head_ = tail_ = 0; }
+
+    // Extracts the next complete frame; returns false if only a partial frame
+    // (or nothing) is buffered.
+    bool pop(Frame& frame) {
+        while (size() >= kHeaderSize) {
+            if (at(0) != kMagic) { ++tail_; ++resync_; continue; }
+            const uint16_t len = static_cast<uint16_t>(at(2) | (at(3) << 8));
+            if (len > kMaxPayload) { ++tail_; ++resync_; continue; }
+            if (size() < kHeaderSize + len) return false;
+
+            frame.opcode = static_cast<Opcode>(at(1));
+            frame.length = len;
+            for (uint16_t i = 0; i < len; ++i) frame.payload[i] = at(kHeaderSize + i);
+            tail_ += kHeaderSize + len;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    uint8_t at(size_t i) const { return buf_[(tail_ + i) & (Capacity - 1)]; }
+
+    uint8_t buf_[Capacity];
+    size_t head_ = 0;
+    size_t tail_ = 0;
+    size_t resync_ = 0;
+};
+
+} // namespace pump_proto
+
+#endif // PUMP_PROTOCOL_H
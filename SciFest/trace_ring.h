@@ -0,0 +1,114 @@
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+// Fixed-capacity trace of command handling. The event loop is the only writer;
+// slots are published with a release store of the head index so a reader on
+// another thread (or the exit dump) sees complete records without locks.
+// When the ring is full the oldest records are overwritten.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "latency_histogram.h"
+
+namespace trace {
+
+enum Stage : uint8_t {
+    SocketReadable  = 0, // epoll reported the robot socket readable
+    FrameParsed     = 1, // frame popped from the ring buffer
+    StateTransition = 2, // dispatch decided on the action
+    GpioDone        = 3, // valve write returned
+    kStageCount     = 4,
+};
+
+struct Record {
+    uint64_t ts_ns;   // CLOCK_MONOTONIC
+    uint32_t event;   // one id per received frame
+    uint8_t stage;
+    uint8_t opcode;
+    uint16_t reserved;
+};
+static_assert(sizeof(Record) == 16, "trace records are dumped as-is");
+
+template <size_t Capacity = 4096>
+class TraceRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    void record(uint32_t event, Stage stage, uint8_t opcode, uint64_t ts_ns) {
+        const uint64_t h = head_.load(std::memory_order_relaxed);
+        records_[h & (Capacity - 1)] = Record{ts_ns, event, stage, opcode, 0};
+        head_.store(h + 1, std::memory_order_release);
+    }
+
+    // Copies the retained records, oldest first, into out; returns how many.
+    size_t snapshot(Record* out, size_t max) const {
+        const uint64_t h = head_.load(std::memory_order_acquire);
+        const uint64_t first = h > Capacity ? h - Capacity : 0;
+        size_t n = 0;
+        for (uint64_t i = first; i < h && n < max; ++i) out[n++] = records_[i & (Capacity - 1)];
+        return n;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    Record records_[Capacity];
+    std::atomic<uint64_t> head_{0};
+};
+
+inline bool write_file(const char* path, const Record* records, size_t n) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) { std::perror(path); return false; }
+    const bool ok = std::fwrite(records, sizeof(Record), n, f) == n;
+    std::fclose(f);
+    return ok;
+}
+
+// Reads a file written by write_file(); returns the number of records read.
+inline size_t read_file(const char* path, Record* out, size_t max) {
+    FILE* f = std::fopen(path, "rb");
+    if (!f) { std::perror(path); return 0; }
+    const size_t n = std::fread(out, sizeof(Record), max, f);
+    std::fclose(f);
+    return n;
+}
+
+// Per-stage latency breakdown. Records of one event are contiguous because
+// the event loop handles one frame at a time.
+inline void report(FILE* out, const Record* records, size_t n) {
+    static const char* kLabels[kStageCount] = {
+        "total  readable->gpio:       ",
+        "parse  readable->frame:      ",
+        "decide frame->transition:    ",
+        "gpio   transition->done:     ",
+    };
+    LatencyHistogram hist[kStageCount];
+
+    size_t i = 0;
+    while (i < n) {
+        const uint32_t event = records[i].event;
+        uint64_t ts[kStageCount] = {};
+        bool seen[kStageCount] = {};
+        for (; i < n && records[i].event == event; ++i) {
+            if (records[i].stage < kStageCount) {
+                ts[records[i].stage] = records[i].ts_ns;
+                seen[records[i].stage] = true;
+            }
+        }
+        if (seen[SocketReadable] && seen[FrameParsed]) hist[1].record(ts[FrameParsed] - ts[SocketReadable]);
+        if (seen[FrameParsed] && seen[StateTransition]) hist[2].record(ts[StateTransition] - ts[FrameParsed]);
+        if (seen[StateTransition] && seen[GpioDone]) hist[3].record(ts[GpioDone] - ts[StateTransition]);
+        if (seen[SocketReadable] && seen[GpioDone]) hist[0].record(ts[GpioDone] - ts[SocketReadable]);
+    }
+
+    std::fprintf(out, "Trace: %zu records\n", n);
+    for (int s = 1; s < kStageCount; ++s) hist[s].print(out, kLabels[s]);
+    hist[0].print(out, kLabels[0]);
+}
+
+} // namespace trace
+
+#endif // TRACE_RING_H
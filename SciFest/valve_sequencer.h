@@ -0,0 +1,72 @@
+#ifndef VALVE_SEQUENCER_H
+#define VALVE_SEQUENCER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+// Active-low semantics: logical 1 => assert (drive pin LOW)
+enum class ValveState { On, Off };
+
+static inline uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static constexpr uint64_t ms_to_ns(uint64_t ms) { return ms * 1000000ull; }
+
+// Timed queue of valve writes. Instead of sleeping between steps, a sequence
+// (e.g. the vent cycle) is queued with absolute CLOCK_MONOTONIC deadlines and
+// the event loop applies whatever is due when its timerfd fires, so socket and
+// stdin keep being served while a sequence is in progress.
+template <size_t Capacity = 16>
+class ValveSequencer {
+public:
+    struct Step {
+        uint64_t due_ns;
+        unsigned offset;
+        ValveState state;
+    };
+
+    bool schedule(uint64_t due_ns, unsigned offset, ValveState state) {
+        if (count_ == Capacity) return false;
+        // Keep steps ordered by deadline; equal deadlines stay in insertion order.
+        size_t i = count_;
+        while (i > 0 && steps_[i - 1].due_ns > due_ns) {
+            steps_[i] = steps_[i - 1];
+            --i;
+        }
+        steps_[i] = Step{due_ns, offset, state};
+        ++count_;
+        return true;
+    }
+
+    // Drops every pending step (a sequence being preempted).
+    void cancel() { count_ = 0; }
+
+    bool idle() const { return count_ == 0; }
+
+    // Deadline of the earliest pending step, 0 when idle.
+    uint64_t next_due() const { return count_ ? steps_[0].due_ns : 0; }
+
+    // Applies all steps due at now_ns, in order; returns how many ran.
+    // apply must not schedule() new steps.
+    template <typename Apply>
+    size_t run_due(uint64_t now_ns, Apply&& apply) {
+        size_t n = 0;
+        while (n < count_ && steps_[n].due_ns <= now_ns) {
+            apply(steps_[n]);
+            ++n;
+        }
+        for (size_t i = n; i < count_; ++i) steps_[i - n] = steps_[i];
+        count_ -= n;
+        return n;
+    }
+
+private:
+    Step steps_[Capacity];
+    size_t count_ = 0;
+};
+
+#endif // VALVE_SEQUENCER_H
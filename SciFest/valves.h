@@ -0,0 +1,80 @@
+#ifndef VALVES_H
+#define VALVES_H
+
+#include <gpiod.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "valve_sequencer.h"
+
+// Output lines of one gpiod_line_request with a cached logical state. Changes
+// are staged and then committed together: one set_values ioctl for every line
+// that actually changed, so solenoids switched in the same commit move in the
+// same instant and rewriting an unchanged value costs nothing.
+template <size_t N>
+class ValveBank {
+public:
+    ValveBank(gpiod_line_request* req, const unsigned (&offsets)[N]) : req_(req) {
+        for (size_t i = 0; i < N; ++i) {
+            offsets_[i] = offsets[i];
+            values_[i] = GPIOD_LINE_VALUE_INACTIVE;
+            dirty_[i] = true; // hardware state unknown until the first commit
+        }
+    }
+
+    void stage(unsigned offset, ValveState state) {
+        const size_t i = index_of(offset);
+        if (i == N) return;
+        const gpiod_line_value v =
+            (state == ValveState::On) ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE;
+        if (v != values_[i]) {
+            values_[i] = v;
+            dirty_[i] = true;
+        }
+    }
+
+    bool commit() {
+        unsigned offs[N];
+        gpiod_line_value vals[N];
+        size_t n = 0;
+        for (size_t i = 0; i < N; ++i) {
+            if (!dirty_[i]) continue;
+            offs[n] = offsets_[i];
+            vals[n] = values_[i];
+            ++n;
+        }
+        if (n == 0) return true;
+        if (gpiod_line_request_set_values_subset(req_, n, offs, vals) < 0) {
+            std::perror("gpiod_line_request_set_values_subset");
+            return false; // keep the lines dirty so the next commit retries
+        }
+        for (size_t i = 0; i < N; ++i) dirty_[i] = false;
+        return true;
+    }
+
+    void set(unsigned offset, ValveState state) {
+        stage(offset, state);
+        commit();
+    }
+
+    ValveState state(unsigned offset) const {
+        const size_t i = index_of(offset);
+        return (i < N && values_[i] == GPIOD_LINE_VALUE_ACTIVE) ? ValveState::On : ValveState::Off;
+    }
+
+private:
+    size_t index_of(unsigned offset) const {
+        for (size_t i = 0; i < N; ++i) {
+            if (offsets_[i] == offset) return i;
+        }
+        return N;
+    }
+
+    gpiod_line_request* req_;
+    unsigned offsets_[N];
+    gpiod_line_value values_[N];
+    bool dirty_[N];
+};
+
+#endif // VALVES_H
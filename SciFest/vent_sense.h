@@ -0,0 +1,88 @@
+#ifndef VENT_SENSE_H
+#define VENT_SENSE_H
+
+#include <gpiod.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Vacuum switch on an input line: active while the cup holds vacuum, inactive
+// once the vent has brought it back to ambient. Edges are detected by the
+// kernel and read from the request's fd, which the event loop watches like
+// any other source; the timestamps are the kernel's CLOCK_MONOTONIC ones, so
+// the release time excludes our own wakeup latency.
+class VentSense {
+public:
+    VentSense() = default;
+    VentSense(const VentSense&) = delete;
+    VentSense& operator=(const VentSense&) = delete;
+    ~VentSense() { close(); }
+
+    bool open(const char* chip_path, unsigned offset, bool active_low, unsigned debounce_us) {
+        gpiod_chip* chip = gpiod_chip_open(chip_path);
+        if (!chip) { std::perror("gpiod_chip_open(vent sense)"); return false; }
+
+        gpiod_line_settings* settings = gpiod_line_settings_new();
+        gpiod_line_config* lcfg = gpiod_line_config_new();
+        gpiod_request_config* rcfg = gpiod_request_config_new();
+        buffer_ = gpiod_edge_event_buffer_new(kBufferSize);
+        if (settings && lcfg && rcfg && buffer_) {
+            gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
+            gpiod_line_settings_set_edge_detection(settings, GPIOD_LINE_EDGE_BOTH);
+            gpiod_line_settings_set_active_low(settings, active_low);
+            gpiod_line_settings_set_debounce_period_us(settings, debounce_us);
+            gpiod_line_settings_set_event_clock(settings, GPIOD_LINE_CLOCK_MONOTONIC);
+            if (gpiod_line_config_add_line_settings(lcfg, &offset, 1, settings) == 0) {
+                gpiod_request_config_set_consumer(rcfg, "pump_vent_sense");
+                req_ = gpiod_chip_request_lines(chip, rcfg, lcfg);
+            }
+        }
+        if (!req_) std::perror("gpiod_chip_request_lines(vent sense)");
+        if (rcfg) gpiod_request_config_free(rcfg);
+        if (lcfg) gpiod_line_config_free(lcfg);
+        if (settings) gpiod_line_settings_free(settings);
+        gpiod_chip_close(chip); // the request stays valid on its own
+        offset_ = offset;
+        if (!req_) close();
+        return req_ != nullptr;
+    }
+
+    void close() {
+        if (req_) gpiod_line_request_release(req_);
+        if (buffer_) gpiod_edge_event_buffer_free(buffer_);
+        req_ = nullptr;
+        buffer_ = nullptr;
+    }
+
+    bool is_open() const { return req_ != nullptr; }
+    int fd() const { return req_ ? gpiod_line_request_get_fd(req_) : -1; }
+
+    // Level right now; true when the cup is back at ambient pressure.
+    bool ambient() const {
+        return req_ && gpiod_line_request_get_value(req_, offset_) == GPIOD_LINE_VALUE_INACTIVE;
+    }
+
+    // Drains pending edges; on_ambient(ts_ns) is called for every
+    // vacuum -> ambient transition. Returns false on a read error.
+    template <typename OnAmbient>
+    bool read(OnAmbient&& on_ambient) {
+        const int n = gpiod_line_request_read_edge_events(req_, buffer_, kBufferSize);
+        if (n < 0) { std::perror("gpiod_line_request_read_edge_events"); return false; }
+        for (int i = 0; i < n; ++i) {
+            gpiod_edge_event* ev = gpiod_edge_event_buffer_get_event(buffer_, static_cast<unsigned long>(i));
+            if (gpiod_edge_event_get_event_type(ev) == GPIOD_EDGE_EVENT_FALLING_EDGE) {
+                on_ambient(gpiod_edge_event_get_timestamp_ns(ev));
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t kBufferSize = 16;
+
+    gpiod_line_request* req_ = nullptr;
+    gpiod_edge_event_buffer* buffer_ = nullptr;
+    unsigned offset_ = 0;
+};
+
+#endif // VENT_SENSE_H
@@ -0,0 +1,82 @@
+// GUI-side costs per trial result: the CSV row (processAndSaveData's
+// successor) and the operator log append (customPrint's). Built only with Qt.
+
+#include <benchmark/benchmark.h>
+
+#include <QApplication>
+#include <QDir>
+#include <QMetaObject>
+#include <QTemporaryDir>
+
+#include "../src/log_view.h"
+#include "../src/result_writer.h"
+
+// Rows go to a scratch directory, one 16-trial block per 16 rows as in a session.
+static void BM_ResultWriter_Rows(benchmark::State& state) {
+    QTemporaryDir dir;
+    const QString cwd = QDir::currentPath();
+    QDir::setCurrent(dir.path());
+    {
+        ResultWriter writer(state.range(0) != 0);
+        TrialResult result;
+        int64_t rows = 0;
+        writer.beginBlock("Block 1", 42, 0);
+        for (auto _ : state) {
+            result.trial = static_cast<int>(rows % 16) + 1;
+            result.operationMs = 6000 + rows % 997;
+            writer.writeTrial(result, static_cast<Trial>(rows & 3), 1000000 * rows);
+            if (++rows % 16 == 0) {
+                writer.endBlock("Block 1", "finished", 96000);
+                writer.beginBlock("Block 1", 42, 1000000 * rows);
+            }
+        }
+        writer.endBlock("Block 1", "finished", 96000);
+        state.SetItemsProcessed(rows);
+    }
+    QDir::setCurrent(cwd);
+}
+// 0: buffered, flushed per block; 1: durable, flushed per row.
+BENCHMARK(BM_ResultWriter_Rows)->Arg(0)->Arg(1);
+
+// One trial's log line plus the frame flush that renders it.
+static void BM_LogView_TrialLine(benchmark::State& state) {
+    LogView view;
+    const int perFlush = static_cast<int>(state.range(0));
+    int64_t lines = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < perFlush; ++i) {
+            view.appendLine("Trial " + QString::number(++lines % 16) + " finished in " + QString::number(6.123) + " s");
+        }
+        QMetaObject::invokeMethod(&view, "flush");
+    }
+    state.SetItemsProcessed(lines);
+}
+// 1: a result per frame; 16: a whole block landing in one frame.
+BENCHMARK(BM_LogView_TrialLine)->Arg(1)->Arg(16);
+
+// The mirrored, colored sequence printout of a block.
+static void BM_LogView_SequenceSpans(benchmark::State& state) {
+    LogView view;
+    for (auto _ : state) {
+        view.appendLine("left ");
+        for (int i = 0; i < 16; ++i) {
+            view.appendSpan(QString::number(i & 1) + " ", (i & 2) ? LogView::Tone::Red : LogView::Tone::Green);
+        }
+        view.appendSpan(" right");
+        QMetaObject::invokeMethod(&view, "flush");
+    }
+    state.SetItemsProcessed(state.iterations() * 18);
+}
+BENCHMARK(BM_LogView_SequenceSpans);
+
+int main(int argc, char** argv) {
+    qputenv("QT_QPA_PLATFORM", qgetenv("QT_QPA_PLATFORM").isEmpty() ? QByteArray("offscreen") : qgetenv("QT_QPA_PLATFORM"));
+    QApplication app(argc, argv);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
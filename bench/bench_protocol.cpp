@@ -0,0 +1,115 @@
+// Robot link hot paths: result stream parsing and block command coding.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <string>
+
+#include "../common/sequence_command.h"
+#include "../emulator/robot_command.h"
+#include "../src/trial_parser.h"
+
+// One experiment block as the robot sends it.
+static std::string result_stream(int trials) {
+    std::string s;
+    for (int i = 1; i <= trials; ++i) s += std::to_string(i) + "," + std::to_string(6000 + 37 * i) + ",finished,";
+    return s + "ff";
+}
+
+// Whole block in one read, the common case on a quiet link.
+static void BM_TrialStreamParser_Block(benchmark::State& state) {
+    const std::string stream = result_stream(static_cast<int>(state.range(0)));
+    TrialStreamParser parser;
+    int64_t trials = 0;
+    for (auto _ : state) {
+        parser.reset();
+        parser.feed(stream.data(), stream.size(), [&](const TrialResult& r) { trials += r.trial; });
+        benchmark::DoNotOptimize(trials);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(stream.size()));
+}
+BENCHMARK(BM_TrialStreamParser_Block)->Arg(16)->Arg(1024);
+
+// The same block split into chunks of range(1) bytes, as the Python robot
+// script writes field by field; fields then straddle reads.
+static void BM_TrialStreamParser_Fragmented(benchmark::State& state) {
+    const std::string stream = result_stream(static_cast<int>(state.range(0)));
+    const size_t chunk = static_cast<size_t>(state.range(1));
+    TrialStreamParser parser;
+    int64_t trials = 0;
+    for (auto _ : state) {
+        parser.reset();
+        for (size_t off = 0; off < stream.size(); off += chunk) {
+            const size_t len = std::min(chunk, stream.size() - off);
+            parser.feed(stream.data() + off, len, [&](const TrialResult& r) { trials += r.trial; });
+        }
+        benchmark::DoNotOptimize(trials);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(stream.size()));
+}
+BENCHMARK(BM_TrialStreamParser_Fragmented)->Args({16, 1})->Args({16, 7})->Args({1024, 64});
+
+static seq_cmd::Command make_command(size_t trials) {
+    seq_cmd::Command cmd;
+    cmd.block = 3;
+    cmd.count = static_cast<uint16_t>(trials);
+    cmd.wait_ms = 5000;
+    cmd.seed = 0x1234567890ABCDEFull;
+    for (size_t i = 0; i < trials; ++i) cmd.trials[i] = static_cast<uint8_t>((i * 7) & 3);
+    return cmd;
+}
+
+static void BM_SequenceCommand_Encode(benchmark::State& state) {
+    const seq_cmd::Command cmd = make_command(static_cast<size_t>(state.range(0)));
+    uint8_t out[seq_cmd::kMaxCommandSize];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(seq_cmd::encode(cmd, out));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SequenceCommand_Encode)->Arg(16)->Arg(1024);
+
+static void BM_SequenceCommand_Decode(benchmark::State& state) {
+    const seq_cmd::Command cmd = make_command(static_cast<size_t>(state.range(0)));
+    uint8_t frame[seq_cmd::kMaxCommandSize];
+    const size_t len = seq_cmd::encode(cmd, frame);
+    seq_cmd::Command decoded;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(seq_cmd::decode(frame, len, decoded));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SequenceCommand_Decode)->Arg(16)->Arg(1024);
+
+// What the robot side does with either form of the same 16-trial block.
+static void BM_RobotCommand_ParseText(benchmark::State& state) {
+    const std::string text = "16,zazazazazzaazaz,5,10\n";
+    robot_cmd::Block block;
+    seq_cmd::Command scratch;
+    size_t used;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(robot_cmd::parse(text.data(), text.size(), false, block, used, scratch));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RobotCommand_ParseText);
+
+static void BM_RobotCommand_ParseBinary(benchmark::State& state) {
+    const seq_cmd::Command cmd = make_command(16);
+    uint8_t frame[seq_cmd::kMaxCommandSize];
+    const size_t len = seq_cmd::encode(cmd, frame);
+    robot_cmd::Block block;
+    seq_cmd::Command scratch;
+    size_t used;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(robot_cmd::parse(reinterpret_cast<const char*>(frame), len, false, block, used, scratch));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RobotCommand_ParseBinary);
@@ -0,0 +1,223 @@
+// pump_control's per-frame path (SciFest/pump_dispatch.h) and its logging,
+// plus round trips of a minimal client against a running emulator
+// (NOVA5_EMULATOR=host:port, its pump port).
+
+#include <benchmark/benchmark.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "../common/event_log.h"
+#include "../SciFest/latency_histogram.h"
+#include "../SciFest/pump_dispatch.h"
+#include "../SciFest/pump_protocol.h"
+#include "../SciFest/trace_ring.h"
+
+using pump_proto::Opcode;
+
+// The robot frames of one sticker delivery, as the robot (or emulator) sends them.
+static size_t delivery_frames(uint8_t* out) {
+    uint8_t payload[12] = {};
+    pump_proto::put_u64(payload, 123456789);
+    payload[8] = 0xF4;
+    payload[9] = 0x01; // ETA 500 ms
+    size_t n = pump_proto::encode(Opcode::ApproachingPickup, payload, 12, out);
+    n += pump_proto::encode(Opcode::PickupReached, payload, 8, out + n);
+    n += pump_proto::encode(Opcode::DropReached, payload, 8, out + n);
+    n += pump_proto::encode(Opcode::StickerFinished, payload, 8, out + n);
+    return n;
+}
+
+// Stand-ins for the GPIO chip: the valve bank's set_values ioctl and the
+// vacuum switch are the only parts of the command path not run here.
+struct BenchBank {
+    ValveState values[2] = {ValveState::Off, ValveState::Off};
+    void stage(unsigned offset, ValveState state) { values[offset & 1] = state; }
+    bool commit() { return true; }
+    void set(unsigned offset, ValveState state) { stage(offset, state); }
+    ValveState state(unsigned offset) const { return values[offset & 1]; }
+};
+
+struct BenchSense {
+    bool is_open() const { return false; }
+    bool ambient() const { return false; }
+};
+
+// Swallows the console output, which still gets formatted.
+struct NullBuf : std::streambuf {
+    int overflow(int c) override { return c; }
+};
+
+// pump_control's on_socket for one delivery: read() from the socket into the
+// ring, then PumpDispatch::drain (pop, trace, state machine, valve staging,
+// timerfds, event log), then the vent cycle its DropReached scheduled.
+// Arg: --prearm-lead in ms.
+static void BM_PumpDispatch_Socket(benchmark::State& state) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+    const int valve_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    const int prearm_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    const int heartbeat_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    uint8_t frames[4 * pump_proto::kMaxFrameSize];
+    const size_t len = delivery_frames(frames);
+    pump_proto::FrameRing<> rx;
+    static trace::TraceRing<> tracer;
+    event_log::EventLog evlog; // not opened, as without --events
+    BenchBank bank;
+    BenchSense sense;
+    NullBuf null_buf;
+    std::ostream out(&null_buf);
+    PumpDispatch<BenchBank, BenchSense> dispatch(bank, sense, 0, 1, static_cast<uint64_t>(state.range(0)),
+                                                 {valve_fd, prearm_fd, heartbeat_fd}, evlog, tracer, out);
+
+    for (auto _ : state) {
+        dispatch.start_delivery();
+        if (write(sv[1], frames, len) != static_cast<ssize_t>(len)) {
+            state.SkipWithError("write failed");
+            break;
+        }
+        size_t got = 0;
+        while (got < len) {
+            const uint64_t wake_ns = monotonic_ns();
+            size_t space;
+            uint8_t* dst = rx.write_region(space);
+            const ssize_t n = read(sv[0], dst, space);
+            const uint64_t rx_ns = monotonic_ns();
+            if (n <= 0) break;
+            rx.commit(static_cast<size_t>(n));
+            got += static_cast<size_t>(n);
+            dispatch.drain(rx, wake_ns, rx_ns);
+        }
+        dispatch.apply_due(UINT64_MAX);
+    }
+    close(sv[0]);
+    close(sv[1]);
+    close(valve_fd);
+    close(prearm_fd);
+    close(heartbeat_fd);
+    state.SetItemsProcessed(state.iterations() * 4);
+    state.counters["p99_ns"] = static_cast<double>(dispatch.stats().cmd_to_gpio.percentile(0.99));
+}
+BENCHMARK(BM_PumpDispatch_Socket)->Arg(0)->Arg(300);
+
+static void BM_EventLog_Append(benchmark::State& state) {
+    static event_log::EventLog log;
+    static const std::string path = "/tmp/nova5_bench_events_" + std::to_string(getpid()) + ".bin";
+    // Thread 0 sets up before, and tears down after, the loop's start and end barriers.
+    if (state.thread_index() == 0) {
+        unlink(path.c_str());
+        log.open(path.c_str(), event_log::Source::Pump, 1u << 24);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(log.append(event_log::Kind::ValveChange, 20, 1));
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        log.close();
+        unlink(path.c_str());
+    }
+}
+BENCHMARK(BM_EventLog_Append)->Threads(1)->Threads(4);
+
+static void BM_LatencyHistogram_Record(benchmark::State& state) {
+    LatencyHistogram hist;
+    uint64_t ns = 1000;
+    for (auto _ : state) {
+        hist.record(ns);
+        ns = ns * 6364136223846793005ull + 1442695040888963407ull;
+        ns >>= 40;
+    }
+    benchmark::DoNotOptimize(hist.percentile(0.5));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LatencyHistogram_Record);
+
+static int connect_emulator(benchmark::State& state) {
+    const char* target = std::getenv("NOVA5_EMULATOR");
+    if (!target) {
+        state.SkipWithError("set NOVA5_EMULATOR=host:port (emulator pump port)");
+        return -1;
+    }
+    const std::string spec(target);
+    const size_t colon = spec.rfind(':');
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(colon == std::string::npos ? 8889 : std::atoi(spec.c_str() + colon + 1)));
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || inet_pton(AF_INET, spec.substr(0, colon).c_str(), &addr.sin_addr) <= 0 ||
+        connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        if (fd >= 0) close(fd);
+        state.SkipWithError("cannot connect to the emulator");
+        return -1;
+    }
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Blocks until a frame with opcode want arrives; false if the link dropped.
+static bool await_frame(int fd, pump_proto::FrameRing<>& rx, Opcode want) {
+    pump_proto::Frame frame;
+    for (;;) {
+        while (rx.pop(frame)) {
+            if (frame.opcode == want) return true;
+        }
+        size_t space;
+        uint8_t* dst = rx.write_region(space);
+        const ssize_t n = read(fd, dst, space);
+        if (n <= 0) return false;
+        rx.commit(static_cast<size_t>(n));
+    }
+}
+
+// The emulator benchmarks time this file's own blocking client, not
+// pump_control: they measure the link and the emulator's side of the protocol.
+static void BM_EmulatorClient_ClockRoundTrip(benchmark::State& state) {
+    const int fd = connect_emulator(state);
+    if (fd < 0) return;
+    pump_proto::FrameRing<> rx;
+    for (auto _ : state) {
+        uint8_t payload[8], frame[pump_proto::kMaxFrameSize];
+        pump_proto::put_u64(payload, event_log::now_ns());
+        const size_t len = pump_proto::encode(Opcode::ClockRequest, payload, sizeof(payload), frame);
+        if (write(fd, frame, len) != static_cast<ssize_t>(len) || !await_frame(fd, rx, Opcode::ClockReply)) {
+            state.SkipWithError("emulator link dropped");
+            break;
+        }
+    }
+    close(fd);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EmulatorClient_ClockRoundTrip)->UseRealTime();
+
+// DeliverSticker to StickerFinished; run the emulator with --speed 0 to time
+// the protocol rather than the emulated motion.
+static void BM_EmulatorClient_Delivery(benchmark::State& state) {
+    const int fd = connect_emulator(state);
+    if (fd < 0) return;
+    pump_proto::FrameRing<> rx;
+    for (auto _ : state) {
+        uint8_t frame[pump_proto::kMaxFrameSize];
+        const size_t len = pump_proto::encode(Opcode::DeliverSticker, frame);
+        if (write(fd, frame, len) != static_cast<ssize_t>(len) || !await_frame(fd, rx, Opcode::StickerFinished)) {
+            state.SkipWithError("emulator link dropped");
+            break;
+        }
+    }
+    close(fd);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EmulatorClient_Delivery)->UseRealTime();
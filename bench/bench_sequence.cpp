@@ -0,0 +1,47 @@
+// Block sequence generation (the old genSeq/seqRadom path) and its text command.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "../src/trial_sequence.h"
+
+static void BM_ShuffledBlock(benchmark::State& state) {
+    const int numBlock = static_cast<int>(state.range(0));
+    uint64_t seed = 1;
+    for (auto _ : state) {
+        TrialSequence seq = shuffledBlock(numBlock, seed++);
+        benchmark::DoNotOptimize(seq);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ShuffledBlock)->Arg(1)->Arg(4);
+
+// A whole session: Baseline, Practice and the three experiment blocks.
+static void BM_SequenceGenerator_Session(benchmark::State& state) {
+    SequenceGenerator generator(42);
+    for (auto _ : state) {
+        for (int numBlock = 1; numBlock <= kBlockCount; ++numBlock) {
+            TrialSequence seq = generator.next(numBlock);
+            benchmark::DoNotOptimize(seq);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockCount);
+}
+BENCHMARK(BM_SequenceGenerator_Session);
+
+// The text command StationPanel::commandFor builds, without the QString layer.
+static void BM_TextCommand_Build(benchmark::State& state) {
+    const TrialSequence seq = shuffledBlock(4, 7);
+    std::string command;
+    for (auto _ : state) {
+        command.clear();
+        command += std::to_string(seq.size);
+        command += ',';
+        for (Trial t : seq) command += isDirect(t) ? 'z' : 'a';
+        command += ",5\n";
+        benchmark::DoNotOptimize(command.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TextCommand_Build);
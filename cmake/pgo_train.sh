@@ -0,0 +1,139 @@
+#!/bin/sh
+# Training run for a -DNOVA5_PGO=GENERATE build (the pgo_train target).
+#
+# Runs nova5_emulator first on a clean link at full speed, then on a slow,
+# jittery, fragmenting one. On its GUI port a scripted client (python3) sends
+# text blocks, alternately one unterminated command and three pipelined
+# newline-terminated ones, and reads their results. On its pump port an
+# instrumented pump_control requests a delivery whenever it is idle. The
+# instrumented binaries exit on SIGINT, which is when the profiles are written.
+#
+# pump_control opens the GPIO chip, so it only trains on the Pi (or a host with
+# gpio-sim); copy the binaries and this script there and pass --out DIR, then
+# copy DIR's files into the build's NOVA5_PGO_DIR. Where it cannot start, the
+# pump port is driven by nova5_bench's emulator client (--bench) instead: that
+# trains the emulator's pump side, but a host build gets no pump_control profile.
+#
+#   pgo_train.sh --emulator PATH [--pump PATH] [--bench PATH] [--seconds N]
+#                [--profile-dir DIR] [--out DIR] [--port N]
+set -u
+
+emulator= pump= bench= seconds=20 profile_dir= out= port=18889
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --emulator) emulator=$2; shift 2 ;;
+        --pump) pump=$2; shift 2 ;;
+        --bench) bench=$2; shift 2 ;;
+        --seconds) seconds=$2; shift 2 ;;
+        --profile-dir) profile_dir=$2; shift 2 ;;
+        --out) out=$2; shift 2 ;;
+        --port) port=$2; shift 2 ;;
+        *) echo "pgo_train.sh: unknown argument $1" >&2; exit 1 ;;
+    esac
+done
+if [ -z "$emulator" ]; then
+    echo "pgo_train.sh: --emulator is required" >&2
+    exit 1
+fi
+gui_port=$((port + 1))
+
+# GCC writes <profile-dir>/<mangled object path>.gcda; --out relocates them.
+if [ -n "$out" ] && [ -n "$profile_dir" ]; then
+    mkdir -p "$out"
+    GCOV_PREFIX=$(cd "$out" && pwd)
+    GCOV_PREFIX_STRIP=$(echo "$profile_dir" | tr -s '/' '\n' | grep -c .)
+    export GCOV_PREFIX GCOV_PREFIX_STRIP
+fi
+# Clang writes .profraw files, merged below.
+[ -n "$profile_dir" ] && LLVM_PROFILE_FILE="${out:-$profile_dir}/nova5-%p-%m.profraw" && export LLVM_PROFILE_FILE
+
+# Plays the GUI until killed: blocks of 1 to 40 random trials, sent as the
+# GUI sends them by default and with --terminated-command.
+gui_client() {
+    python3 - "$gui_port" <<'EOF'
+import random, socket, sys
+
+sock = socket.create_connection(("127.0.0.1", int(sys.argv[1])))
+rng = random.Random(1)
+
+def command(pause, newline):
+    n = rng.randint(1, 40)
+    bits = "".join(rng.choice("za") for _ in range(n))
+    text = f"{n},{bits},0.5" + (f",{pause}" if pause is not None else "")
+    return text + "\n" if newline else text
+
+buf = b""
+while True:
+    pipelined = rng.random() < 0.5
+    blocks = [command(None, pipelined)]
+    if pipelined:
+        blocks += [command(1, True), command(1, True)]
+    sock.sendall("".join(blocks).encode())
+    for _ in blocks:
+        while b"ff" not in buf:
+            data = sock.recv(65536)
+            if not data:
+                sys.exit(0)
+            buf += data
+        buf = buf[buf.index(b"ff") + 2:]
+EOF
+}
+
+# Runs nova5_bench's emulator client on the pump port until killed.
+bench_client() {
+    trap 'kill "$child" 2>/dev/null; exit 0' TERM
+    while :; do
+        NOVA5_EMULATOR=127.0.0.1:$port "$bench" --benchmark_filter=EmulatorClient >/dev/null 2>&1 &
+        child=$!
+        wait "$child" || exit 0
+    done
+}
+
+# workload NAME EMULATOR_ARGS...
+workload() {
+    name=$1; shift
+    echo "pgo_train: $name workload, ${seconds} s"
+    "$emulator" --gui-port "$gui_port" --pump-port "$port" --quiet "$@" &
+    emulator_pid=$!
+    sleep 1
+    clients=
+    if command -v python3 >/dev/null 2>&1; then
+        gui_client &
+        clients="$clients $!"
+    else
+        echo "pgo_train: no python3, the emulator's GUI side is not trained" >&2
+    fi
+    pump_pid=
+    if [ -n "$pump" ]; then
+        # pump_control ignores a request while it is still delivering.
+        (while :; do echo; sleep 0.05; done) | "$pump" --host 127.0.0.1 --port "$port" >/dev/null &
+        pump_pid=$!
+        sleep 1
+        if ! kill -0 "$pump_pid" 2>/dev/null; then
+            echo "pgo_train: pump_control exited (no GPIO chip?) and is not trained" >&2
+            pump_pid=
+        fi
+    fi
+    if [ -z "$pump_pid" ] && [ -n "$bench" ]; then
+        bench_client &
+        clients="$clients $!"
+    fi
+    sleep "$seconds"
+    if [ -n "$pump_pid" ]; then
+        kill -INT "$pump_pid" 2>/dev/null
+        wait "$pump_pid" 2>/dev/null
+    fi
+    for pid in $clients; do kill -TERM "$pid" 2>/dev/null; done
+    for pid in $clients; do wait "$pid" 2>/dev/null; done
+    kill -INT "$emulator_pid" 2>/dev/null
+    wait "$emulator_pid" 2>/dev/null
+}
+
+workload clean --speed 0 --seed 1
+workload rough --speed 20 --seed 2 --latency 5 --jitter 20 --fragment 3 --clock-offset 120000
+
+dir=${out:-$profile_dir}
+if [ -n "$dir" ] && ls "$dir"/*.profraw >/dev/null 2>&1; then
+    llvm-profdata merge -output="$dir/nova5.profdata" "$dir"/*.profraw
+fi
+echo "pgo_train: profiles in ${dir:-the build tree}"
@@ -0,0 +1,34 @@
+# Cross-compiles for the Raspberry Pi that runs pump_control (64-bit Raspberry
+# Pi OS). The sysroot needs libgpiod >= 2.0 and its .pc file, e.g. copied
+# from the Pi after `apt install libgpiod-dev`:
+#
+#   cmake -S . -B build-pi -DCMAKE_TOOLCHAIN_FILE=cmake/toolchains/rpi-aarch64.cmake \
+#         -DRPI_SYSROOT=/opt/rpi-sysroot -DCMAKE_BUILD_TYPE=RT
+#   cmake --build build-pi --target pump_control nova5_emulator
+#
+# RPI_CPU picks the tuning (cortex-a72 for a Pi 4, cortex-a76 for a Pi 5).
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR aarch64)
+
+set(RPI_SYSROOT "$ENV{RPI_SYSROOT}" CACHE PATH "Root filesystem of the Pi")
+set(RPI_CPU cortex-a72 CACHE STRING "-mcpu of the target Pi")
+set(RPI_TRIPLE aarch64-linux-gnu CACHE STRING "Prefix of the cross toolchain")
+# try_compile projects see only the toolchain file, not the cache.
+list(APPEND CMAKE_TRY_COMPILE_PLATFORM_VARIABLES RPI_SYSROOT RPI_CPU RPI_TRIPLE)
+
+set(CMAKE_C_COMPILER ${RPI_TRIPLE}-gcc)
+set(CMAKE_CXX_COMPILER ${RPI_TRIPLE}-g++)
+set(CMAKE_CXX_FLAGS_INIT "-mcpu=${RPI_CPU}")
+
+if(RPI_SYSROOT)
+    set(CMAKE_SYSROOT ${RPI_SYSROOT})
+    # pkg-config must read the Pi's .pc files, never the build host's.
+    set(ENV{PKG_CONFIG_DIR} "")
+    set(ENV{PKG_CONFIG_LIBDIR} "${RPI_SYSROOT}/usr/lib/${RPI_TRIPLE}/pkgconfig:${RPI_SYSROOT}/usr/share/pkgconfig")
+    set(ENV{PKG_CONFIG_SYSROOT_DIR} ${RPI_SYSROOT})
+endif()
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_PACKAGE ONLY)
@@ -0,0 +1,260 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+// Binary event log shared by the GUI (src/) and the pump controller (SciFest/).
+//
+// A file is a 32-byte header followed by fixed 32-byte records stamped with
+// CLOCK_MONOTONIC. The file is mapped once and never written with write():
+// appending reserves a slot with one atomic add and fills it in place, so
+// a log call costs a few stores. Both processes write their own file in the
+// same format; the records merge into one timeline by mono_ns. Robot
+// timestamps are moved onto that timeline with the ClockSync offsets the pump
+// controller records.
+//
+// A reserved slot whose seq is still 0 was cut off by a crash and is skipped
+// by readers.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+namespace event_log {
+
+enum class Source : uint16_t { Gui = 1, Pump = 2, Robot = 3 };
+
+enum class Kind : uint16_t {
+    // GUI
+    ButtonPress     = 1,  // a: block number (0 = Start, -1 = Abort, 6 = Block 1-3)
+    CommandSent     = 2,  // a: block number, b: trials in the sequence
+    TrialResult     = 3,  // a: trial number, b: robot operation time in ms
+    BlockStart      = 4,  // a: block number, b: sequence seed
+    BlockEnd        = 5,  // a: block number, b: 0 finished, 1 failed, 2 aborted
+    LinkUp          = 6,
+    LinkDown        = 7,
+    // pump controller; a: robot time on the local timeline (-1 if unknown)
+    PickupReached   = 16,
+    DropReached     = 17,
+    StickerFinished = 18,
+    DeliverSent     = 19,
+    ValveChange     = 20, // a: line offset, b: 1 on, 0 off
+    ApproachingPickup = 21, // b: ETA in ms
+    AmbientReached  = 22, // vent sense edge; b: ns since the vent opened
+    // a: robot clock minus local clock in ns, b: round trip in ns
+    ClockSync       = 32,
+};
+
+inline const char* kind_name(uint16_t kind) {
+    switch (static_cast<Kind>(kind)) {
+        case Kind::ButtonPress:     return "button press";
+        case Kind::CommandSent:     return "command sent";
+        case Kind::TrialResult:     return "trial result";
+        case Kind::BlockStart:      return "block start";
+        case Kind::BlockEnd:        return "block end";
+        case Kind::LinkUp:          return "link up";
+        case Kind::LinkDown:        return "link down";
+        case Kind::PickupReached:   return "pickup reached";
+        case Kind::DropReached:     return "drop reached";
+        case Kind::StickerFinished: return "sticker finished";
+        case Kind::DeliverSent:     return "deliver sent";
+        case Kind::ValveChange:     return "valve change";
+        case Kind::ApproachingPickup: return "approaching pickup";
+        case Kind::AmbientReached:  return "ambient reached";
+        case Kind::ClockSync:       return "clock sync";
+    }
+    return "unknown";
+}
+
+struct Record {
+    uint64_t mono_ns; // CLOCK_MONOTONIC
+    uint32_t seq;     // 1-based position in the file, written last
+    uint16_t source;
+    uint16_t kind;
+    int64_t a;
+    int64_t b;
+};
+static_assert(sizeof(Record) == 32, "records are mapped as-is");
+
+struct Header {
+    char magic[8];              // "NOVA5EVT"
+    uint32_t version;
+    uint16_t record_size;
+    uint16_t source;            // Source of the writer; 0 in version 1 files
+    uint64_t capacity;          // records the file was sized for
+    std::atomic<uint64_t> count; // slots reserved so far
+};
+static_assert(sizeof(Header) == 32, "header is mapped as-is");
+
+static constexpr char kMagic[8] = {'N', 'O', 'V', 'A', '5', 'E', 'V', 'T'};
+// Version 2 adds Header::source; version 1 files (a 32-bit record_size) read the same.
+static constexpr uint32_t kVersion = 2;
+// Free records reserved by open(): 32 MiB of sparse file, trimmed to what was
+// used on close.
+static constexpr uint64_t kDefaultCapacity = 1u << 20;
+
+inline uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// NTP-style offset from one request/reply exchange: t1 local send, t2 remote
+// receive, t3 remote send, t4 local receive.
+inline int64_t clock_offset(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4) {
+    return (static_cast<int64_t>(t2 - t1) + static_cast<int64_t>(t3 - t4)) / 2;
+}
+inline int64_t round_trip(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4) {
+    return static_cast<int64_t>(t4 - t1) - static_cast<int64_t>(t3 - t2);
+}
+
+// Appends to a mapped log file. append() may be called from any thread; open()
+// and close() may not race with it.
+class EventLog {
+public:
+    EventLog() = default;
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+    ~EventLog() { close(); }
+
+    // Creates the file, or continues an existing log of this version written
+    // by the same source. capacity is the free space wanted: an existing log
+    // that still has that many free slots (after a crash skipped close()) is
+    // not grown, so restarts never add up.
+    bool open(const char* path, Source source, uint64_t capacity = kDefaultCapacity) {
+        close();
+        fd_ = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) { std::perror(path); return false; }
+
+        struct stat st;
+        if (fstat(fd_, &st) < 0) { std::perror("fstat"); close(); return false; }
+        uint64_t used = 0;
+        uint64_t sized = 0;
+        if (static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+            Header existing;
+            if (pread(fd_, &existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing)) ||
+                std::memcmp(existing.magic, kMagic, sizeof(kMagic)) != 0 || existing.record_size != sizeof(Record)) {
+                std::fprintf(stderr, "%s: not an event log\n", path);
+                close();
+                return false;
+            }
+            if (existing.version != kVersion || existing.source != static_cast<uint16_t>(source)) {
+                std::fprintf(stderr, "%s: event log of another version or source, not appending to it\n", path);
+                close();
+                return false;
+            }
+            used = existing.count.load(std::memory_order_relaxed);
+            const uint64_t in_file = (static_cast<uint64_t>(st.st_size) - sizeof(Header)) / sizeof(Record);
+            sized = std::min(existing.capacity, in_file);
+            used = std::min(used, sized);
+        }
+        capacity_ = sized - used >= capacity ? sized : used + capacity;
+        bytes_ = sizeof(Header) + capacity_ * sizeof(Record);
+        if (capacity_ != sized && ftruncate(fd_, static_cast<off_t>(bytes_)) < 0) {
+            std::perror("ftruncate");
+            close();
+            return false;
+        }
+
+        void* map = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED) { std::perror("mmap"); map_ = nullptr; close(); return false; }
+        map_ = static_cast<uint8_t*>(map);
+        header_ = reinterpret_cast<Header*>(map_);
+        records_ = reinterpret_cast<Record*>(map_ + sizeof(Header));
+        if (sized == 0) {
+            std::memcpy(header_->magic, kMagic, sizeof(kMagic));
+            header_->version = kVersion;
+            header_->record_size = sizeof(Record);
+            header_->source = static_cast<uint16_t>(source);
+        }
+        header_->count.store(used, std::memory_order_relaxed);
+        header_->capacity = capacity_;
+        source_ = source;
+        return true;
+    }
+
+    void close() {
+        if (map_) {
+            const uint64_t used = std::min(header_->count.load(), capacity_);
+            header_->count.store(used);
+            header_->capacity = used;
+            munmap(map_, bytes_);
+            if (ftruncate(fd_, static_cast<off_t>(sizeof(Header) + used * sizeof(Record))) < 0) std::perror("ftruncate");
+            map_ = nullptr;
+            header_ = nullptr;
+            records_ = nullptr;
+        }
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool is_open() const { return map_ != nullptr; }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Returns false (and counts a drop) when the log is closed or full.
+    bool append(Kind kind, int64_t a = 0, int64_t b = 0, uint64_t mono_ns = now_ns()) {
+        if (!map_) return false;
+        const uint64_t slot = header_->count.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= capacity_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Record& r = records_[slot];
+        r.mono_ns = mono_ns;
+        r.source = static_cast<uint16_t>(source_);
+        r.kind = static_cast<uint16_t>(kind);
+        r.a = a;
+        r.b = b;
+        __atomic_store_n(&r.seq, static_cast<uint32_t>(slot + 1), __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    int fd_ = -1;
+    uint8_t* map_ = nullptr;
+    size_t bytes_ = 0;
+    Header* header_ = nullptr;
+    Record* records_ = nullptr;
+    uint64_t capacity_ = 0;
+    Source source_ = Source::Gui;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// Reads every complete record of a log file; returns false if it is not one.
+inline bool read_file(const char* path, std::vector<Record>& out) {
+    out.clear();
+    FILE* f = std::fopen(path, "rb");
+    if (!f) { std::perror(path); return false; }
+    Header header;
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1 &&
+              std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.record_size == sizeof(Record);
+    if (ok) {
+        Record r;
+        for (uint64_t i = 0, n = header.count.load(); i < n && std::fread(&r, sizeof(r), 1, f) == 1; ++i) {
+            if (r.seq != 0) out.push_back(r);
+        }
+    }
+    std::fclose(f);
+    if (!ok) std::fprintf(stderr, "%s: not an event log\n", path);
+    return ok;
+}
+
+inline void print(FILE* out, const std::vector<Record>& records) {
+    for (const Record& r : records) {
+        std::fprintf(out, "%llu.%09llu  %-5s %-16s %lld %lld\n",
+                     static_cast<unsigned long long>(r.mono_ns / 1000000000ull),
+                     static_cast<unsigned long long>(r.mono_ns % 1000000000ull),
+                     r.source == 1 ? "gui" : r.source == 2 ? "pump" : "robot", kind_name(r.kind),
+                     static_cast<long long>(r.a), static_cast<long long>(r.b));
+    }
+}
+
+} // namespace event_log
+
+#endif // EVENT_LOG_H
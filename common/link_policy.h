@@ -0,0 +1,51 @@
+#ifndef LINK_POLICY_H
+#define LINK_POLICY_H
+
+// Connection policy shared by the GUI (src/) and the pump controller (SciFest/)
+// for their long-lived TCP links to the Nova5 controller.
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <algorithm>
+
+namespace link_policy {
+
+// Dead peers are detected after idle + interval * count seconds.
+static constexpr int kKeepIdleS = 5;
+static constexpr int kKeepIntervalS = 2;
+static constexpr int kKeepCount = 3;
+
+static constexpr int kConnectTimeoutMs = 2000;
+static constexpr int kBackoffInitialMs = 100;
+static constexpr int kBackoffMaxMs = 2000;
+
+// Disable Nagle and enable aggressive keepalive on a connected socket.
+inline bool tune_socket(int fd) {
+    const int one = 1;
+    bool ok = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == 0;
+    ok = setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one)) == 0 && ok;
+#ifdef TCP_KEEPIDLE
+    ok = setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &kKeepIdleS, sizeof(kKeepIdleS)) == 0 && ok;
+    ok = setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &kKeepIntervalS, sizeof(kKeepIntervalS)) == 0 && ok;
+    ok = setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &kKeepCount, sizeof(kKeepCount)) == 0 && ok;
+#endif
+    return ok;
+}
+
+// Exponential reconnect delay: 100 ms, 200 ms, 400 ms ... capped at kBackoffMaxMs.
+class Backoff {
+public:
+    int next_ms() {
+        current_ms_ = current_ms_ == 0 ? kBackoffInitialMs : std::min(current_ms_ * 2, kBackoffMaxMs);
+        return current_ms_;
+    }
+    void reset() { current_ms_ = 0; }
+
+private:
+    int current_ms_ = 0;
+};
+
+} // namespace link_policy
+
+#endif // LINK_POLICY_H
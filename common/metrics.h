@@ -0,0 +1,231 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// Live counters for the GUI (src/) and the pump controller (SciFest/),
+// exported in the Prometheus text format over a minimal HTTP endpoint.
+//
+// Updating a metric is one relaxed atomic add, safe from any thread (the
+// video threads, the pump's event loop) and never allocates. Metrics are
+// registered once at startup; a scrape renders every registered metric from
+// the thread that serves the endpoint. Histograms have fixed upper bounds in
+// ns and are exported in seconds, as Prometheus expects.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace metrics {
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+class Histogram {
+public:
+    // bounds_ns: ascending bucket upper bounds; +Inf is implied.
+    explicit Histogram(std::initializer_list<uint64_t> bounds_ns)
+        : bounds_(bounds_ns), counts_(new std::atomic<uint64_t>[bounds_ns.size() + 1]) {
+        for (size_t i = 0; i <= bounds_.size(); ++i) counts_[i].store(0, std::memory_order_relaxed);
+    }
+
+    void observe_ns(uint64_t ns) {
+        const size_t b = static_cast<size_t>(std::lower_bound(bounds_.begin(), bounds_.end(), ns) - bounds_.begin());
+        counts_[b].fetch_add(1, std::memory_order_relaxed);
+        sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    const std::vector<uint64_t>& bounds() const { return bounds_; }
+    uint64_t bucket(size_t i) const { return counts_[i].load(std::memory_order_relaxed); }
+    uint64_t sum_ns() const { return sum_ns_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<uint64_t> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> sum_ns_{0};
+};
+
+static constexpr uint64_t kUs = 1000ull, kMs = 1000000ull, kS = 1000000000ull;
+
+// Bucket sets shared by both processes.
+inline Histogram gpio_latency_histogram() {   // socket readable -> valve written
+    return Histogram{10 * kUs, 25 * kUs, 50 * kUs, 100 * kUs, 250 * kUs, 500 * kUs, 1 * kMs, 5 * kMs, 25 * kMs, 100 * kMs};
+}
+inline Histogram vent_histogram() {           // vent open -> closed
+    return Histogram{50 * kMs, 100 * kMs, 200 * kMs, 300 * kMs, 500 * kMs, 750 * kMs, 1 * kS, 2 * kS};
+}
+inline Histogram trial_histogram() {          // robot operation time per trial
+    return Histogram{2 * kS, 4 * kS, 6 * kS, 8 * kS, 10 * kS, 12 * kS, 15 * kS, 20 * kS, 30 * kS, 60 * kS};
+}
+
+// The robot link as both processes run it (see link_policy.h).
+struct LinkMetrics {
+    Counter connect_attempts;
+    Counter connect_failures;
+    Counter link_drops; // an established link that went down
+    Counter bytes_in;
+    Counter bytes_out;
+};
+
+// Formats one label pair, escaping the value: label("station", "Cell A").
+inline std::string label(const char* key, const std::string& value) {
+    std::string out = key;
+    out += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        out += c;
+    }
+    return out + '"';
+}
+
+class Registry {
+public:
+    // Registered metrics must outlive the registry; labels is "" or
+    // label() pairs joined by commas.
+    void add(const char* name, const char* help, const Counter& m, std::string labels = {}) {
+        entries_.push_back({name, help, std::move(labels), Type::Counter, &m});
+    }
+    void add(const char* name, const char* help, const Gauge& m, std::string labels = {}) {
+        entries_.push_back({name, help, std::move(labels), Type::Gauge, &m});
+    }
+    void add(const char* name, const char* help, const Histogram& m, std::string labels = {}) {
+        entries_.push_back({name, help, std::move(labels), Type::Histogram, &m});
+    }
+    void add_link(const char* prefix, const LinkMetrics& m, const std::string& labels = {}) {
+        const std::string p = prefix;
+        names_.push_back(p + "_connect_attempts_total");
+        add(names_.back().c_str(), "Connection attempts to the robot.", m.connect_attempts, labels);
+        names_.push_back(p + "_connect_failures_total");
+        add(names_.back().c_str(), "Connection attempts that failed or timed out.", m.connect_failures, labels);
+        names_.push_back(p + "_link_drops_total");
+        add(names_.back().c_str(), "Established robot links that went down.", m.link_drops, labels);
+        names_.push_back(p + "_received_bytes_total");
+        add(names_.back().c_str(), "Bytes received from the robot.", m.bytes_in, labels);
+        names_.push_back(p + "_sent_bytes_total");
+        add(names_.back().c_str(), "Bytes sent to the robot.", m.bytes_out, labels);
+    }
+
+    // Prometheus text exposition format 0.0.4; series of one name stay together.
+    std::string render() const {
+        std::vector<size_t> order(entries_.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return std::strcmp(entries_[a].name, entries_[b].name) < 0;
+        });
+        std::string out;
+        out.reserve(256 * entries_.size());
+        const char* last = nullptr;
+        for (size_t i : order) {
+            const Entry& e = entries_[i];
+            if (!last || std::strcmp(last, e.name) != 0) {
+                out.append("# HELP ").append(e.name).append(" ").append(e.help).append("\n");
+                out.append("# TYPE ").append(e.name).append(" ").append(type_name(e.type)).append("\n");
+                last = e.name;
+            }
+            switch (e.type) {
+                case Type::Counter:
+                    sample(out, e.name, "", e.labels, {}, std::to_string(static_cast<const Counter*>(e.metric)->value()));
+                    break;
+                case Type::Gauge:
+                    sample(out, e.name, "", e.labels, {}, std::to_string(static_cast<const Gauge*>(e.metric)->value()));
+                    break;
+                case Type::Histogram:
+                    histogram(out, e, *static_cast<const Histogram*>(e.metric));
+                    break;
+            }
+        }
+        return out;
+    }
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+    struct Entry {
+        const char* name;
+        const char* help;
+        std::string labels;
+        Type type;
+        const void* metric;
+    };
+
+    static const char* type_name(Type t) {
+        return t == Type::Counter ? "counter" : t == Type::Gauge ? "gauge" : "histogram";
+    }
+
+    static std::string seconds(uint64_t ns) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.9g", static_cast<double>(ns) / 1e9);
+        return buf;
+    }
+
+    static void sample(std::string& out, const char* name, const char* suffix, const std::string& labels,
+                       const std::string& extra, const std::string& value) {
+        out.append(name).append(suffix);
+        if (!labels.empty() || !extra.empty()) {
+            out += '{';
+            out += labels;
+            if (!labels.empty() && !extra.empty()) out += ',';
+            out += extra;
+            out += '}';
+        }
+        out.append(" ").append(value).append("\n");
+    }
+
+    static void histogram(std::string& out, const Entry& e, const Histogram& h) {
+        // Buckets are read one by one, so a scrape racing an observe can be off
+        // by that one observation; _count is their sum so the series stays consistent.
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < h.bounds().size(); ++b) {
+            cumulative += h.bucket(b);
+            sample(out, e.name, "_bucket", e.labels, "le=\"" + seconds(h.bounds()[b]) + "\"", std::to_string(cumulative));
+        }
+        cumulative += h.bucket(h.bounds().size());
+        sample(out, e.name, "_bucket", e.labels, "le=\"+Inf\"", std::to_string(cumulative));
+        sample(out, e.name, "_sum", e.labels, {}, seconds(h.sum_ns()));
+        sample(out, e.name, "_count", e.labels, {}, std::to_string(cumulative));
+    }
+
+    std::vector<Entry> entries_;
+    std::deque<std::string> names_; // composed names; a deque never moves them
+};
+
+// Complete HTTP/1.0 response to a request read so far, or "" while its header
+// is incomplete. GET /metrics (or /) gets the exposition, anything else 404.
+inline std::string http_response(const char* request, size_t len, const Registry& registry) {
+    const std::string req(request, len);
+    if (req.find("\r\n\r\n") == std::string::npos && req.find("\n\n") == std::string::npos) {
+        return len >= 8192 ? "HTTP/1.0 431 Request Header Fields Too Large\r\nContent-Length: 0\r\n\r\n" : "";
+    }
+    const bool metrics = req.compare(0, 13, "GET /metrics ") == 0 || req.compare(0, 6, "GET / ") == 0 ||
+                         req.compare(0, 13, "GET /metrics?") == 0;
+    if (!metrics) return "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n\r\nnot found\n";
+    const std::string body = registry.render();
+    return "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) +
+           "\r\nConnection: close\r\n\r\n" + body;
+}
+
+} // namespace metrics
+
+#endif // METRICS_H
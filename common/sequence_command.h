@@ -0,0 +1,152 @@
+#ifndef SEQUENCE_COMMAND_H
+#define SEQUENCE_COMMAND_H
+
+// Binary block command sent by the GUI (src/) to the robot script, replacing
+// the text form "<len>,<z/a bits>,<wait seconds>". All fields little endian:
+//
+//   byte 0..1    magic "NQ" (the text form always starts with a digit)
+//   byte 2       version (1)
+//   byte 3       flags, reserved (0)
+//   byte 4       block number (1 = Baseline ... 5 = Block 3)
+//   byte 5       reserved (0)
+//   byte 6..7    trial count (0..kMaxTrials)
+//   byte 8..11   wait at the home spot, ms
+//   byte 12..15  pause before starting a queued block, ms (0 = start now)
+//   byte 16..23  sequence seed
+//   byte 24..    trials, 2 bits each, trial 0 in the low bits of the first byte:
+//                bit 1 = red cube, bit 0 = false trajectory (as Trial in
+//                src/trial_sequence.h); padding bits are 0
+//   last 4       CRC-32 (IEEE 802.3) of every byte before it
+//
+// Unlike the text form this carries color and trajectory separately, so all
+// four trial conditions are expressed; direct/indirect follows from the two.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace seq_cmd {
+
+static constexpr uint8_t kMagic0 = 'N';
+static constexpr uint8_t kMagic1 = 'Q';
+static constexpr uint8_t kVersion = 1;
+static constexpr size_t kHeaderSize = 24;
+static constexpr size_t kCrcSize = 4;
+static constexpr size_t kMaxTrials = 1024;
+
+constexpr size_t encoded_size(size_t trials) { return kHeaderSize + (trials + 3) / 4 + kCrcSize; }
+
+static constexpr size_t kMaxCommandSize = encoded_size(kMaxTrials);
+
+struct Command {
+    uint8_t block = 0;
+    uint16_t count = 0;
+    uint32_t wait_ms = 0;
+    uint32_t pause_ms = 0;
+    uint64_t seed = 0;
+    uint8_t trials[kMaxTrials] = {}; // one 2-bit code per entry
+};
+
+enum class Status { Ok, Incomplete, BadMagic, BadVersion, BadLength, BadCrc };
+
+inline const char* status_name(Status s) {
+    switch (s) {
+        case Status::Ok:         return "ok";
+        case Status::Incomplete: return "incomplete";
+        case Status::BadMagic:   return "bad magic";
+        case Status::BadVersion: return "unsupported version";
+        case Status::BadLength:  return "bad trial count";
+        case Status::BadCrc:     return "CRC mismatch";
+    }
+    return "unknown";
+}
+
+namespace detail {
+
+struct CrcTable {
+    uint32_t v[256];
+    constexpr CrcTable() : v() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            v[i] = c;
+        }
+    }
+};
+static constexpr CrcTable kCrcTable;
+
+inline void put_u16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+inline void put_u32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i)); }
+inline void put_u64(uint8_t* p, uint64_t v) { for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i)); }
+inline uint16_t get_u16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+inline uint32_t get_u32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+inline uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+} // namespace detail
+
+inline uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) crc = detail::kCrcTable.v[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Writes cmd into out (at least encoded_size(cmd.count) bytes); returns the
+// size, or 0 when count exceeds kMaxTrials.
+inline size_t encode(const Command& cmd, uint8_t* out) {
+    if (cmd.count > kMaxTrials) return 0;
+    out[0] = kMagic0;
+    out[1] = kMagic1;
+    out[2] = kVersion;
+    out[3] = 0;
+    out[4] = cmd.block;
+    out[5] = 0;
+    detail::put_u16(out + 6, cmd.count);
+    detail::put_u32(out + 8, cmd.wait_ms);
+    detail::put_u32(out + 12, cmd.pause_ms);
+    detail::put_u64(out + 16, cmd.seed);
+    uint8_t* packed = out + kHeaderSize;
+    const size_t packed_size = (cmd.count + 3) / 4;
+    for (size_t i = 0; i < packed_size; ++i) packed[i] = 0;
+    for (size_t i = 0; i < cmd.count; ++i) packed[i / 4] |= static_cast<uint8_t>((cmd.trials[i] & 3u) << (2 * (i % 4)));
+    const size_t body = kHeaderSize + packed_size;
+    detail::put_u32(out + body, crc32(out, body));
+    return body + kCrcSize;
+}
+
+// Validates and unpacks one command from the start of data: the CRC is
+// checked over the whole frame first, so cmd is left untouched by a corrupt
+// one, then the trials are unpacked. On Ok, *used is its size; Incomplete
+// means more bytes are needed.
+inline Status decode(const uint8_t* data, size_t len, Command& cmd, size_t* used = nullptr) {
+    if (len >= 1 && data[0] != kMagic0) return Status::BadMagic;
+    if (len >= 2 && data[1] != kMagic1) return Status::BadMagic;
+    if (len < kHeaderSize) return Status::Incomplete;
+    if (data[2] != kVersion) return Status::BadVersion;
+    const uint16_t count = detail::get_u16(data + 6);
+    if (count > kMaxTrials) return Status::BadLength;
+    const size_t size = encoded_size(count);
+    if (len < size) return Status::Incomplete;
+    const size_t body = size - kCrcSize;
+    if (crc32(data, body) != detail::get_u32(data + body)) return Status::BadCrc;
+
+    cmd.block = data[4];
+    cmd.count = count;
+    cmd.wait_ms = detail::get_u32(data + 8);
+    cmd.pause_ms = detail::get_u32(data + 12);
+    cmd.seed = detail::get_u64(data + 16);
+    const uint8_t* packed = data + kHeaderSize;
+    for (size_t i = 0; i < count; ++i) cmd.trials[i] = (packed[i / 4] >> (2 * (i % 4))) & 3u;
+    if (used) *used = size;
+    return Status::Ok;
+}
+
+} // namespace seq_cmd
+
+#endif // SEQUENCE_COMMAND_H
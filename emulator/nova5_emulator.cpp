@@ -0,0 +1,518 @@
+// Robot and pump-side emulator for the Nova5 cell.
+//
+// Plays both roles of the robot:
+//   - towards the GUI (src/): accepts block commands (text or binary, see
+//     robot_command.h) and answers each trial with "<n>,<ms>,finished," and the
+//     block with "ff", exactly as TrialStreamParser expects;
+//   - towards pump_control (SciFest/): answers ClockRequest and runs the
+//     approach/pickup/drop/finished frame sequence for every DeliverSticker.
+//
+// Everything the emulator decides (operation times, jitter, drops, write
+// fragmentation) comes from one seeded generator per connection, so a run with
+// the same --seed and the same commands produces the same byte stream. Time can
+// be compressed with --speed; reported operation times stay in robot ms, only
+// the wall-clock delays shrink. --speed 0 removes all delays, which is what a
+// load test of the GUI's session engine, parser and writers wants.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "../SciFest/pump_protocol.h"
+#include "robot_command.h"
+
+static constexpr int GUI_PORT = 8888;
+static constexpr int PUMP_PORT = 8889;
+
+struct Profile {
+    double speed = 1.0;          // robot ms per wall ms; 0 = no delays at all
+    uint64_t seed = 1;
+    uint32_t motion_ms = 4000;   // pick and place on the direct path, on top of the wait
+    uint32_t indirect_ms = 1500; // extra for the indirect path
+    uint32_t latency_ms = 0;     // one-way delay added to everything sent
+    uint32_t jitter_ms = 0;      // +- uniform, on latency and on every motion time
+    double drop = 0.0;           // probability a trial record or pump frame is lost
+    size_t fragment = 0;         // split writes into chunks of 1..N bytes (0 = off)
+    int64_t clock_offset_ms = 0; // robot clock ahead of the host's
+    uint32_t approach_ms = 500;  // pump sequence, as in pump_dummy.py
+    uint32_t carry_ms = 2000;
+    uint32_t return_ms = 2000;
+    bool strict_text = false;    // text waits for its newline; else a read is a whole command
+    bool quiet = false;
+};
+
+static uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// splitmix64: tiny, and unlike the std:: distributions it gives the same
+// sequence with every standard library.
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state_(seed) {}
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    double unit() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+    // Uniform in [-span, span].
+    int64_t spread(uint32_t span) {
+        return span == 0 ? 0 : static_cast<int64_t>(next() % (2ull * span + 1)) - static_cast<int64_t>(span);
+    }
+    bool chance(double p) { return p > 0 && unit() < p; }
+
+private:
+    uint64_t state_;
+};
+
+enum class Role { Gui, Pump };
+
+// Where an outgoing pump frame gets the robot clock written when it is sent.
+enum class Stamp { None, Clock, ClockReplyT3 };
+
+struct Client {
+    Client(int fd_, Role role_, uint32_t gen_, uint64_t seed) : fd(fd_), role(role_), gen(gen_), rng(seed) {}
+
+    int fd;
+    Role role;
+    uint32_t gen;
+    Rng rng;
+    std::string in;                 // GUI commands not parsed yet
+    pump_proto::FrameRing<> rx;     // pump frames
+    std::string out;                // bytes due but not yet accepted by the socket
+    uint64_t robot_free_ns = 0;     // when the emulated robot is done with the last block
+    uint64_t tx_ns = 0;             // last scheduled delivery; keeps the stream in order
+    uint64_t delivery_done_ns = 0;  // pump sequence busy until then
+    seq_cmd::Command scratch;
+    uint64_t trials = 0, blocks = 0;
+};
+
+struct Pending {
+    uint64_t due_ns;
+    uint64_t order;
+    size_t slot;
+    uint32_t gen;
+    Stamp stamp;
+    std::string bytes;
+};
+
+struct Later {
+    bool operator()(const Pending& a, const Pending& b) const {
+        return a.due_ns != b.due_ns ? a.due_ns > b.due_ns : a.order > b.order;
+    }
+};
+
+struct Stats {
+    uint64_t commands = 0, bad_commands = 0, blocks = 0, trials = 0, dropped = 0;
+    uint64_t pump_frames = 0, deliveries = 0, clock_replies = 0, bytes_out = 0;
+    uint64_t first_command_ns = 0, last_record_ns = 0;
+};
+
+static Profile profile;
+static Stats stats;
+static int epfd = -1;
+static int timer_fd = -1;
+static std::vector<std::unique_ptr<Client>> clients;
+static std::priority_queue<Pending, std::vector<Pending>, Later> timeline;
+static uint64_t next_order = 0;
+static uint32_t next_gen = 0;
+
+// epoll data: the listeners and timer use fixed ids, clients their slot + kClientBase.
+static constexpr uint64_t kSignalId = 0, kTimerId = 1, kGuiListenId = 2, kPumpListenId = 3, kClientBase = 16;
+
+static uint64_t scaled_ns(int64_t robot_ms) {
+    if (profile.speed <= 0 || robot_ms <= 0) return 0;
+    return static_cast<uint64_t>(static_cast<double>(robot_ms) * 1e6 / profile.speed);
+}
+
+static uint64_t robot_clock_ns() {
+    return monotonic_ns() + static_cast<uint64_t>(profile.clock_offset_ms * 1000000);
+}
+
+static void arm_timeline() {
+    itimerspec its{};
+    if (!timeline.empty()) {
+        // An absolute time of 0 would disarm; anything due is due now.
+        const uint64_t due = std::max<uint64_t>(timeline.top().due_ns, 1);
+        its.it_value.tv_sec = static_cast<time_t>(due / 1000000000ull);
+        its.it_value.tv_nsec = static_cast<long>(due % 1000000000ull);
+    }
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, nullptr) < 0) std::perror("timerfd_settime");
+}
+
+// Queues bytes for the client at robot event time at_ns; the latency profile
+// is applied here, without ever reordering the stream.
+static void schedule(Client& c, size_t slot, uint64_t at_ns, std::string bytes, Stamp stamp = Stamp::None) {
+    const int64_t lat_ms = static_cast<int64_t>(profile.latency_ms) + (profile.latency_ms ? c.rng.spread(profile.jitter_ms) : 0);
+    uint64_t due = at_ns + scaled_ns(lat_ms);
+    if (due < c.tx_ns) due = c.tx_ns;
+    c.tx_ns = due;
+    timeline.push(Pending{due, next_order++, slot, c.gen, stamp, std::move(bytes)});
+}
+
+static void watch_client(size_t slot, uint32_t ev) {
+    epoll_event e{};
+    e.events = ev;
+    e.data.u64 = kClientBase + slot;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, clients[slot]->fd, &e);
+}
+
+static void drop_client(size_t slot, const char* why) {
+    Client& c = *clients[slot];
+    if (!profile.quiet) {
+        std::cout << (c.role == Role::Gui ? "GUI" : "Pump") << " client " << slot << " closed (" << why << "), "
+                  << c.blocks << " blocks, " << c.trials << " trials\n";
+    }
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c.fd, nullptr);
+    close(c.fd);
+    clients[slot].reset(); // pending output for it is skipped by generation
+}
+
+// Writes as much of c.out as the socket takes, in random chunks with --fragment.
+static bool flush(size_t slot) {
+    Client& c = *clients[slot];
+    size_t sent = 0;
+    while (sent < c.out.size()) {
+        size_t chunk = c.out.size() - sent;
+        if (profile.fragment > 0) chunk = std::min(chunk, 1 + static_cast<size_t>(c.rng.next() % profile.fragment));
+        const ssize_t n = send(c.fd, c.out.data() + sent, chunk, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) break;
+            drop_client(slot, std::strerror(errno));
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+        stats.bytes_out += static_cast<uint64_t>(n);
+    }
+    c.out.erase(0, sent);
+    watch_client(slot, c.out.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT);
+    return true;
+}
+
+static void run_timeline() {
+    uint64_t expirations;
+    (void)read(timer_fd, &expirations, sizeof(expirations));
+    const uint64_t now = monotonic_ns();
+    std::vector<size_t> touched;
+    while (!timeline.empty() && timeline.top().due_ns <= now) {
+        Pending p = timeline.top();
+        timeline.pop();
+        if (p.slot >= clients.size() || !clients[p.slot] || clients[p.slot]->gen != p.gen) continue;
+        Client& c = *clients[p.slot];
+        if (p.stamp != Stamp::None) {
+            uint8_t* payload = reinterpret_cast<uint8_t*>(&p.bytes[pump_proto::kHeaderSize]);
+            pump_proto::put_u64(p.stamp == Stamp::Clock ? payload : payload + 16, robot_clock_ns());
+        }
+        if (c.out.empty()) touched.push_back(p.slot);
+        c.out += p.bytes;
+        if (c.role == Role::Gui) stats.last_record_ns = now;
+    }
+    for (size_t slot : touched) {
+        if (clients[slot]) flush(slot);
+    }
+    arm_timeline();
+}
+
+static void run_block(size_t slot, const robot_cmd::Block& block) {
+    Client& c = *clients[slot];
+    const uint64_t now = monotonic_ns();
+    uint64_t t = std::max(now, c.robot_free_ns);
+    // A queued block starts its pause after the previous one, wherever the GUI is.
+    if (block.pause_ms >= 0) t += scaled_ns(block.pause_ms);
+    for (uint16_t i = 0; i < block.count; ++i) {
+        int64_t ms = static_cast<int64_t>(block.wait_ms) + profile.motion_ms + (block.direct[i] ? 0 : profile.indirect_ms) +
+                     c.rng.spread(profile.jitter_ms);
+        if (ms < 0) ms = 0;
+        t += scaled_ns(ms);
+        if (c.rng.chance(profile.drop)) {
+            ++stats.dropped;
+            continue;
+        }
+        schedule(c, slot, t, std::to_string(i + 1) + "," + std::to_string(ms) + ",finished,");
+        ++c.trials;
+        ++stats.trials;
+    }
+    // The terminator is never dropped: a lost "ff" is a hung block, not a lossy one.
+    schedule(c, slot, t, "ff");
+    c.robot_free_ns = t;
+    ++c.blocks;
+    ++stats.blocks;
+}
+
+static void on_gui_readable(size_t slot) {
+    Client& c = *clients[slot];
+    char buf[4096];
+    const ssize_t n = read(c.fd, buf, sizeof(buf));
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (n <= 0) { drop_client(slot, n == 0 ? "closed by peer" : std::strerror(errno)); return; }
+    c.in.append(buf, static_cast<size_t>(n));
+
+    size_t offset = 0;
+    robot_cmd::Block block;
+    while (offset < c.in.size()) {
+        size_t used = 0;
+        const robot_cmd::Parse r = robot_cmd::parse(c.in.data() + offset, c.in.size() - offset, !profile.strict_text, block, used, c.scratch);
+        if (r == robot_cmd::Parse::NeedMore) break;
+        if (r == robot_cmd::Parse::Bad) {
+            ++stats.bad_commands;
+            std::cerr << "Bad command from GUI client " << slot << "\n";
+            drop_client(slot, "bad command");
+            return;
+        }
+        if (stats.commands++ == 0) stats.first_command_ns = monotonic_ns();
+        if (!profile.quiet) {
+            std::cout << "Block of " << block.count << " trials (" << (block.binary ? "binary" : "text") << ", wait "
+                      << block.wait_ms << " ms" << (block.pause_ms >= 0 ? ", queued" : "") << ")\n";
+        }
+        run_block(slot, block);
+        offset += used;
+    }
+    c.in.erase(0, offset);
+    arm_timeline();
+}
+
+static std::string pump_frame(pump_proto::Opcode op, const uint8_t* payload, uint16_t len) {
+    uint8_t frame[pump_proto::kMaxFrameSize];
+    const size_t n = pump_proto::encode(op, payload, len, frame);
+    return std::string(reinterpret_cast<const char*>(frame), n);
+}
+
+static void on_pump_readable(size_t slot) {
+    using pump_proto::Opcode;
+    Client& c = *clients[slot];
+    size_t space;
+    uint8_t* dst = c.rx.write_region(space);
+    const ssize_t n = read(c.fd, dst, space);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (n <= 0) { drop_client(slot, n == 0 ? "closed by peer" : std::strerror(errno)); return; }
+    c.rx.commit(static_cast<size_t>(n));
+    const uint64_t now = monotonic_ns();
+
+    pump_proto::Frame frame;
+    while (c.rx.pop(frame)) {
+        if (frame.opcode == Opcode::ClockRequest && frame.length >= 8) {
+            uint8_t payload[24];
+            std::memcpy(payload, frame.payload, 8);
+            pump_proto::put_u64(payload + 8, robot_clock_ns());
+            pump_proto::put_u64(payload + 16, 0); // t3, stamped when sent
+            schedule(c, slot, now, pump_frame(Opcode::ClockReply, payload, sizeof(payload)), Stamp::ClockReplyT3);
+            ++stats.clock_replies;
+        } else if (frame.opcode == Opcode::DeliverSticker && now >= c.delivery_done_ns) {
+            uint8_t payload[12] = {};
+            const uint64_t approach = scaled_ns(profile.approach_ms + c.rng.spread(profile.jitter_ms));
+            const uint32_t eta_ms = static_cast<uint32_t>(approach / 1000000);
+            payload[8] = static_cast<uint8_t>(eta_ms);
+            payload[9] = static_cast<uint8_t>(eta_ms >> 8);
+            payload[10] = static_cast<uint8_t>(eta_ms >> 16);
+            payload[11] = static_cast<uint8_t>(eta_ms >> 24);
+            uint64_t t = now;
+            if (!c.rng.chance(profile.drop)) schedule(c, slot, t, pump_frame(Opcode::ApproachingPickup, payload, 12), Stamp::Clock);
+            t += approach;
+            if (!c.rng.chance(profile.drop)) schedule(c, slot, t, pump_frame(Opcode::PickupReached, payload, 8), Stamp::Clock);
+            t += scaled_ns(profile.carry_ms + c.rng.spread(profile.jitter_ms));
+            if (!c.rng.chance(profile.drop)) schedule(c, slot, t, pump_frame(Opcode::DropReached, payload, 8), Stamp::Clock);
+            t += scaled_ns(profile.return_ms + c.rng.spread(profile.jitter_ms));
+            // Like "ff", never dropped: the controller would wait for it forever.
+            schedule(c, slot, t, pump_frame(Opcode::StickerFinished, payload, 8), Stamp::Clock);
+            c.delivery_done_ns = t;
+            ++stats.deliveries;
+            stats.pump_frames += 4;
+        }
+    }
+    arm_timeline();
+}
+
+static void accept_client(int listen_fd, Role role) {
+    for (;;) {
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EINTR) std::perror("accept4");
+            return;
+        }
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        size_t slot = 0;
+        while (slot < clients.size() && clients[slot]) ++slot;
+        if (slot == clients.size()) clients.emplace_back();
+        const uint32_t gen = ++next_gen;
+        // Seeded per connection, in accept order, so runs repeat byte for byte.
+        clients[slot].reset(new Client(fd, role, gen, profile.seed ^ (0x9E3779B97F4A7C15ull * gen)));
+        epoll_event e{};
+        e.events = EPOLLIN;
+        e.data.u64 = kClientBase + slot;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &e);
+        if (!profile.quiet) std::cout << (role == Role::Gui ? "GUI" : "Pump") << " client " << slot << " connected\n";
+    }
+}
+
+static int listen_on(const char* ip, int port, uint64_t id) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) { std::perror("socket"); return -1; }
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) {
+        std::cerr << "Invalid address " << ip << "\n";
+        close(fd);
+        return -1;
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        std::perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+    epoll_event e{};
+    e.events = EPOLLIN;
+    e.data.u64 = id;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &e);
+    return fd;
+}
+
+static void print_stats() {
+    const double span_s = stats.last_record_ns > stats.first_command_ns
+                              ? static_cast<double>(stats.last_record_ns - stats.first_command_ns) / 1e9
+                              : 0.0;
+    std::cout << "Commands " << stats.commands << " (" << stats.bad_commands << " bad), blocks " << stats.blocks
+              << ", trials " << stats.trials << " (" << stats.dropped << " dropped)";
+    if (span_s > 0) std::cout << ", " << static_cast<uint64_t>(stats.trials / span_s) << " trials/s";
+    std::cout << "\nDeliveries " << stats.deliveries << ", pump frames " << stats.pump_frames << ", clock replies "
+              << stats.clock_replies << ", bytes out " << stats.bytes_out << "\n";
+}
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--bind IP] [--gui-port N] [--pump-port N] [--speed X] [--seed N]\n"
+              << "       " << std::string(std::strlen(prog), ' ') << " [--motion-ms MS] [--indirect-ms MS] [--latency MS] [--jitter MS]\n"
+              << "       " << std::string(std::strlen(prog), ' ') << " [--drop P] [--fragment N] [--clock-offset MS] [--strict-text] [--quiet]\n"
+              << "  --speed 0 sends every result as fast as the socket takes it; --gui-port/--pump-port 0 disables a side\n";
+}
+
+int main(int argc, char** argv) {
+    const char* bind_ip = "0.0.0.0";
+    int gui_port = GUI_PORT;
+    int pump_port = PUMP_PORT;
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--bind") == 0 && has_value) {
+            bind_ip = argv[++i];
+        } else if (std::strcmp(argv[i], "--gui-port") == 0 && has_value) {
+            gui_port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--pump-port") == 0 && has_value) {
+            pump_port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--speed") == 0 && has_value) {
+            profile.speed = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && has_value) {
+            profile.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--motion-ms") == 0 && has_value) {
+            profile.motion_ms = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--indirect-ms") == 0 && has_value) {
+            profile.indirect_ms = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--latency") == 0 && has_value) {
+            profile.latency_ms = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--jitter") == 0 && has_value) {
+            profile.jitter_ms = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--drop") == 0 && has_value) {
+            profile.drop = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--fragment") == 0 && has_value) {
+            profile.fragment = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--clock-offset") == 0 && has_value) {
+            profile.clock_offset_ms = std::atoll(argv[++i]);
+        } else if (std::strcmp(argv[i], "--strict-text") == 0) {
+            profile.strict_text = true;
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            profile.quiet = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    const int sigfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (epfd < 0 || timer_fd < 0 || sigfd < 0) { std::perror("epoll/timerfd/signalfd"); return 1; }
+    epoll_event e{};
+    e.events = EPOLLIN;
+    e.data.u64 = kSignalId;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, sigfd, &e);
+    e.data.u64 = kTimerId;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, timer_fd, &e);
+
+    const int gui_fd = gui_port > 0 ? listen_on(bind_ip, gui_port, kGuiListenId) : -1;
+    const int pump_fd = pump_port > 0 ? listen_on(bind_ip, pump_port, kPumpListenId) : -1;
+    if ((gui_port > 0 && gui_fd < 0) || (pump_port > 0 && pump_fd < 0)) return 1;
+    std::cout << "Emulating the robot on " << bind_ip;
+    if (gui_fd >= 0) std::cout << ", GUI port " << gui_port;
+    if (pump_fd >= 0) std::cout << ", pump port " << pump_port;
+    std::cout << " (speed " << profile.speed << ", seed " << profile.seed << ")\n";
+
+    bool running = true;
+    epoll_event events[32];
+    while (running) {
+        const int nev = epoll_wait(epfd, events, 32, -1);
+        if (nev < 0) {
+            if (errno == EINTR) continue;
+            std::perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < nev && running; ++i) {
+            const uint64_t id = events[i].data.u64;
+            if (id == kSignalId) {
+                running = false;
+            } else if (id == kTimerId) {
+                run_timeline();
+            } else if (id == kGuiListenId) {
+                accept_client(gui_fd, Role::Gui);
+            } else if (id == kPumpListenId) {
+                accept_client(pump_fd, Role::Pump);
+            } else {
+                const size_t slot = static_cast<size_t>(id - kClientBase);
+                if (slot >= clients.size() || !clients[slot]) continue;
+                if ((events[i].events & EPOLLOUT) && !flush(slot)) continue;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    if (clients[slot]->role == Role::Gui) on_gui_readable(slot);
+                    else on_pump_readable(slot);
+                }
+            }
+        }
+    }
+
+    print_stats();
+    for (size_t slot = 0; slot < clients.size(); ++slot) {
+        if (clients[slot]) drop_client(slot, "shutdown");
+    }
+    if (gui_fd >= 0) close(gui_fd);
+    if (pump_fd >= 0) close(pump_fd);
+    close(timer_fd);
+    close(sigfd);
+    close(epfd);
+    return 0;
+}
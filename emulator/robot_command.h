@@ -0,0 +1,125 @@
+#ifndef ROBOT_COMMAND_H
+#define ROBOT_COMMAND_H
+
+// Block commands as the robot receives them from the GUI, in either form:
+//
+//   text    "<len>,<z/a bits>,<wait s>[,<pause s>]\n"   (z = direct, a = indirect)
+//   binary  see common/sequence_command.h
+//
+// The first byte tells them apart: text always starts with a digit. The GUI
+// sends text without the newline, one command per write, unless it runs with
+// --terminated-command; the caller passes end_of_read to take a read that ends
+// on an unterminated text command as the whole command.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "../common/sequence_command.h"
+
+namespace robot_cmd {
+
+struct Block {
+    uint16_t count = 0;
+    bool direct[seq_cmd::kMaxTrials] = {};
+    uint32_t wait_ms = 0;
+    int64_t pause_ms = -1; // -1: start right away, otherwise queued behind the previous block
+    bool binary = false;
+    uint8_t block = 0;     // binary only, 0 when unknown
+};
+
+enum class Parse { Ok, NeedMore, Bad };
+
+namespace detail {
+
+// Parses a non-negative decimal with an optional fraction, in units of 1/1000.
+inline bool parse_milli(const char* p, const char* end, int64_t& out) {
+    int64_t whole = 0, frac = 0, scale = 1000;
+    bool digits = false, dot = false;
+    for (; p < end; ++p) {
+        if (*p >= '0' && *p <= '9') {
+            digits = true;
+            if (!dot) {
+                whole = whole * 10 + (*p - '0');
+            } else if (scale > 1) {
+                scale /= 10;
+                frac += (*p - '0') * scale;
+            }
+        } else if (*p == '.' && !dot) {
+            dot = true;
+        } else if (*p != ' ' && *p != '\r') {
+            return false;
+        }
+    }
+    out = whole * 1000 + frac;
+    return digits;
+}
+
+inline Parse parse_text(const char* line, const char* end, Block& block) {
+    const char* fields[4];
+    const char* field_end[4];
+    int n = 0;
+    const char* start = line;
+    for (const char* p = line; p <= end; ++p) {
+        if (p == end || *p == ',') {
+            if (n == 4) return Parse::Bad;
+            fields[n] = start;
+            field_end[n++] = p;
+            start = p + 1;
+        }
+    }
+    if (n < 3) return Parse::Bad;
+
+    int64_t len;
+    if (!parse_milli(fields[0], field_end[0], len) || len % 1000 != 0) return Parse::Bad;
+    len /= 1000;
+    const size_t bits = static_cast<size_t>(field_end[1] - fields[1]);
+    if (len < 0 || static_cast<size_t>(len) != bits || bits > seq_cmd::kMaxTrials) return Parse::Bad;
+    block.count = static_cast<uint16_t>(bits);
+    for (size_t i = 0; i < bits; ++i) {
+        const char c = fields[1][i];
+        if (c != 'z' && c != 'a') return Parse::Bad;
+        block.direct[i] = c == 'z';
+    }
+    int64_t wait;
+    if (!parse_milli(fields[2], field_end[2], wait)) return Parse::Bad;
+    block.wait_ms = static_cast<uint32_t>(wait);
+    block.pause_ms = -1;
+    if (n == 4 && !parse_milli(fields[3], field_end[3], block.pause_ms)) return Parse::Bad;
+    block.binary = false;
+    block.block = 0;
+    return Parse::Ok;
+}
+
+} // namespace detail
+
+// Parses the command at the start of data. On Ok, *used bytes were consumed;
+// on Bad the caller should drop the connection, as the real script would.
+inline Parse parse(const char* data, size_t len, bool end_of_read, Block& block, size_t& used, seq_cmd::Command& scratch) {
+    if (len == 0) return Parse::NeedMore;
+    if (static_cast<uint8_t>(data[0]) == seq_cmd::kMagic0) {
+        const seq_cmd::Status status = seq_cmd::decode(reinterpret_cast<const uint8_t*>(data), len, scratch, &used);
+        if (status == seq_cmd::Status::Incomplete) return Parse::NeedMore;
+        if (status != seq_cmd::Status::Ok) return Parse::Bad;
+        block.count = scratch.count;
+        for (size_t i = 0; i < scratch.count; ++i) {
+            // Green cubes go direct on a true trajectory, red ones on a false one.
+            const bool green = (scratch.trials[i] & 2) == 0, true_path = (scratch.trials[i] & 1) == 0;
+            block.direct[i] = green == true_path;
+        }
+        block.wait_ms = scratch.wait_ms;
+        block.pause_ms = scratch.pause_ms > 0 ? scratch.pause_ms : -1;
+        block.binary = true;
+        block.block = scratch.block;
+        return Parse::Ok;
+    }
+    const char* nl = static_cast<const char*>(std::memchr(data, '\n', len));
+    if (!nl && !end_of_read) return Parse::NeedMore;
+    const char* end = nl ? nl : data + len;
+    used = static_cast<size_t>(end - data) + (nl ? 1 : 0);
+    return detail::parse_text(data, end, block);
+}
+
+} // namespace robot_cmd
+
+#endif // ROBOT_COMMAND_H
@@ -0,0 +1,85 @@
+#include "face_models.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+static constexpr int kDetectorInput = 300;
+static constexpr int kEmotionInput = 64;
+
+// FER+ output order: neutral, happiness, surprise, sadness, anger, disgust, fear, contempt.
+static constexpr int kFerPlusIndex[kEmotionCount] = {4, 5, 6, 1, 0, 3, 2};
+
+static cv::dnn::Net load_net(const std::string& model, const std::string& config) {
+    cv::dnn::Net net = cv::dnn::readNet(model, config);
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    return net;
+}
+
+FaceDetector::FaceDetector(const std::string& model, const std::string& config, float threshold)
+    : net_(load_net(model, config)), threshold_(threshold) {}
+
+void FaceDetector::detect(const std::vector<cv::Mat>& images, std::vector<FaceBox>& out) {
+    out.assign(images.size(), FaceBox{});
+    if (images.empty()) return;
+
+    cv::dnn::blobFromImages(images, blob_, 1.0, cv::Size(kDetectorInput, kDetectorInput),
+                            cv::Scalar(104.0, 177.0, 123.0), false, false);
+    net_.setInput(blob_);
+    const cv::Mat result = net_.forward();
+
+    // [1, 1, N, 7]: image id, label, confidence, x1, y1, x2, y2 (normalized).
+    const cv::Mat rows(result.size[2], result.size[3], CV_32F, const_cast<float*>(result.ptr<float>()));
+    for (int r = 0; r < rows.rows; ++r) {
+        const float* d = rows.ptr<float>(r);
+        const int id = static_cast<int>(d[0]);
+        const float confidence = d[2];
+        if (id < 0 || id >= static_cast<int>(images.size()) || confidence < threshold_) continue;
+
+        const cv::Size size = images[id].size();
+        const float x1 = std::clamp(d[3], 0.f, 1.f) * size.width;
+        const float y1 = std::clamp(d[4], 0.f, 1.f) * size.height;
+        const float x2 = std::clamp(d[5], 0.f, 1.f) * size.width;
+        const float y2 = std::clamp(d[6], 0.f, 1.f) * size.height;
+        if (x2 <= x1 || y2 <= y1) continue;
+
+        FaceBox& best = out[id];
+        const float centre = (y1 + y2) / 2;
+        if (!best.found || centre > best.box.y + best.box.height / 2) {
+            best.box = cv::Rect2f(x1, y1, x2 - x1, y2 - y1);
+            best.confidence = confidence;
+            best.found = true;
+        }
+    }
+}
+
+EmotionClassifier::EmotionClassifier(const std::string& model) : net_(load_net(model, "")) {}
+
+void EmotionClassifier::classify(const std::vector<cv::Mat>& faces,
+                                 std::vector<std::array<float, kEmotionCount>>& out) {
+    out.resize(faces.size());
+    if (faces.empty()) return;
+
+    gray_.resize(faces.size());
+    for (size_t i = 0; i < faces.size(); ++i) {
+        cv::cvtColor(faces[i], gray_[i], cv::COLOR_BGR2GRAY);
+    }
+    cv::dnn::blobFromImages(gray_, blob_, 1.0, cv::Size(kEmotionInput, kEmotionInput), cv::Scalar(), false, false);
+    net_.setInput(blob_);
+    const cv::Mat logits = net_.forward().reshape(1, static_cast<int>(faces.size()));
+
+    for (int i = 0; i < logits.rows; ++i) {
+        const float* l = logits.ptr<float>(i);
+        float max_logit = l[0];
+        for (int k = 1; k < logits.cols; ++k) max_logit = std::max(max_logit, l[k]);
+        float p[kEmotionCount];
+        float sum = 0.f;
+        for (int e = 0; e < kEmotionCount; ++e) {
+            p[e] = std::exp(l[kFerPlusIndex[e]] - max_logit);
+            sum += p[e];
+        }
+        for (int e = 0; e < kEmotionCount; ++e) out[i][e] = 100.f * p[e] / sum;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef FACE_MODELS_H
+#define FACE_MODELS_H
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+
+// Emotion columns in the order face_analysis.py writes them.
+static constexpr int kEmotionCount = 7;
+static constexpr const char* kEmotionNames[kEmotionCount] = {
+    "angry", "disgust", "fear", "happy", "neutral", "sad", "surprise"};
+
+struct FaceBox {
+    cv::Rect2f box;          // in the coordinates of the image passed in
+    float confidence = 0.f;
+    bool found = false;
+};
+
+// SSD-style face detector (e.g. OpenCV's res10_300x300_ssd, Caffe or ONNX
+// export) run through cv::dnn. A whole batch of crops goes through one
+// forward(); the DetectionOutput rows carry the image index, so each crop gets
+// its own result. Not thread-safe: one instance per worker.
+class FaceDetector {
+public:
+    FaceDetector(const std::string& model, const std::string& config, float threshold);
+
+    // One face per image: the bottom-most one above the threshold, matching
+    // face_crop.py (the participant sits in the lower part of the crop).
+    void detect(const std::vector<cv::Mat>& images, std::vector<FaceBox>& out);
+
+private:
+    cv::dnn::Net net_;
+    float threshold_;
+    cv::Mat blob_;
+};
+
+// FER+ style classifier: 64x64 grayscale in, eight logits out. Scores are
+// softmaxed, "contempt" is dropped and the rest rescaled to percentages, the
+// scale DeepFace.analyze() reports, so the columns slot into the same analysis.
+class EmotionClassifier {
+public:
+    explicit EmotionClassifier(const std::string& model);
+
+    void classify(const std::vector<cv::Mat>& faces, std::vector<std::array<float, kEmotionCount>>& out);
+
+private:
+    cv::dnn::Net net_;
+    std::vector<cv::Mat> gray_;
+    cv::Mat blob_;
+};
+
+#endif // FACE_MODELS_H
@@ -0,0 +1,488 @@
+// Native replacement for the per-frame loops in video_scipt/face_crop.py and
+// face_analysis.py. Video is decoded in parallel, one segment per worker (the
+// segments of a recording directory written by the Qt GUI, or whole files),
+// and faces are detected in batches through cv::dnn. Frames whose crop region
+// has not changed since the last detection reuse that result instead of
+// running the detector again. With --track K the detector only runs every K
+// frames (or when the tracker loses the face) and optical flow follows the
+// face in between; emotions are still classified on every frame.
+//
+// Output is one .npy file per column in --out, e.g. with pandas:
+//     df = pd.DataFrame({p.stem: np.load(p) for p in Path(out).glob('*.npy')})
+//
+// Built by the top-level CMake build when OpenCV 4 with dnn, video, videoio
+// and imgproc is found: cmake --build build --target face_tool
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "face_models.h"
+#include "npy_writer.h"
+#include "roi_tracker.h"
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::string out_dir = "face_out";
+    std::string detector;
+    std::string detector_config;
+    std::string emotion_model;
+    float threshold = 0.5f;
+    cv::Rect crop{200, 180, 100, 80}; // same default as face_analysis.py
+    int threads = 0;
+    int batch = 16;
+    double stable_threshold = 2.0; // mean abs grey-level change of the crop
+    int max_skip = 15;             // force a detection after this many reused frames
+    int track_every = 0;           // 0: reuse stable frames; K: detect every K frames, track in between
+    float track_confidence = 0.6f; // share of corners that must survive a tracking step
+    bool crops = false;
+};
+
+struct Segment {
+    std::string path;
+    int64_t first_frame = -1; // from segments.csv; -1 for plain files
+};
+
+enum FrameState : uint8_t { kNoFace = 0, kDetected = 1, kReused = 2, kTracked = 3 };
+
+struct FrameRow {
+    int64_t offset = 0; // frame within its segment
+    float x = 0, y = 0, w = 0, h = 0, confidence = 0;
+    uint8_t state = kNoFace;
+    std::array<float, kEmotionCount> emotion{};
+};
+
+struct SegmentResult {
+    std::vector<FrameRow> rows;
+    double fps = 0;
+    int64_t detector_frames = 0;
+};
+
+static constexpr int kCropSize = 128; // matches face_crop.py
+static const cv::Size kThumbSize(32, 24);
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --detector MODEL [--detector-config FILE] [--emotion MODEL]\n"
+              << "       [--out DIR] [--crop X,Y,W,H] [--threshold T] [--threads N] [--batch N]\n"
+              << "       [--stable T] [--max-skip N] [--track K] [--track-confidence C] [--crops]\n"
+              << "       RECORDING_DIR | VIDEO...\n";
+}
+
+static bool file_exists(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+// A recording directory lists its segments in segments.csv; anything else is
+// taken as one video file per segment.
+static std::vector<Segment> find_segments(const std::vector<std::string>& inputs) {
+    std::vector<Segment> segments;
+    for (const std::string& input : inputs) {
+        const std::string index = input + "/segments.csv";
+        if (!file_exists(index)) {
+            segments.push_back({input, -1});
+            continue;
+        }
+        std::ifstream in(index);
+        std::string line;
+        std::getline(in, line); // header
+        while (std::getline(in, line)) {
+            std::stringstream fields(line);
+            std::string segment, file, first;
+            if (std::getline(fields, segment, ',') && std::getline(fields, file, ',') && std::getline(fields, first, ',')) {
+                segments.push_back({input + "/" + file, std::atoll(first.c_str())});
+            }
+        }
+    }
+    return segments;
+}
+
+// frames.csv of the recording: global frame -> monotonic ns.
+static std::vector<int64_t> load_frame_times(const std::string& dir) {
+    std::vector<int64_t> times;
+    std::ifstream in(dir + "/frames.csv");
+    std::string line;
+    std::getline(in, line);
+    while (std::getline(in, line)) {
+        const size_t comma = line.find(',');
+        if (comma != std::string::npos) times.push_back(std::atoll(line.c_str() + comma + 1));
+    }
+    return times;
+}
+
+class SegmentProcessor {
+public:
+    explicit SegmentProcessor(const Options& opt)
+        : opt_(opt), detector_(opt.detector, opt.detector_config, opt.threshold) {
+        if (!opt.emotion_model.empty()) emotions_ = std::make_unique<EmotionClassifier>(opt.emotion_model);
+    }
+
+    void run(const Segment& segment, const std::string& crops_path, SegmentResult& result) {
+        cv::VideoCapture cap(segment.path);
+        if (!cap.isOpened()) {
+            std::cerr << "Cannot open " << segment.path << "\n";
+            return;
+        }
+        result.fps = cap.get(cv::CAP_PROP_FPS);
+        result_ = &result;
+        tracker_.reset();
+        face_seen_ = false;
+        const bool tracking = opt_.track_every > 0;
+        if (opt_.crops) {
+            crops_.open(crops_path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), result.fps > 0 ? result.fps : 30,
+                        cv::Size(kCropSize, kCropSize));
+        }
+
+        cv::Mat frame, grey, thumb, reference;
+        int since_detect = tracking ? opt_.track_every : opt_.max_skip;
+        for (int64_t offset = 0; cap.read(frame); ++offset) {
+            const cv::Rect area = opt_.crop & cv::Rect(0, 0, frame.cols, frame.rows);
+            const cv::Mat roi = frame(area);
+            cv::cvtColor(roi, grey, cv::COLOR_BGR2GRAY);
+
+            Pending p;
+            p.row = result.rows.size();
+            p.origin = area.tl();
+            result.rows.push_back(FrameRow{offset});
+            if (tracking) {
+                // Every frame keeps its crop: tracked frames are still classified.
+                p.roi = roi.clone();
+                p.grey = grey.clone();
+                if (since_detect >= opt_.track_every - 1) {
+                    p.batch_index = static_cast<int>(batch_.size());
+                    batch_.push_back(p.roi);
+                    since_detect = 0;
+                } else {
+                    ++since_detect;
+                }
+                pending_.push_back(std::move(p));
+                if (static_cast<int>(batch_.size()) == opt_.batch) flush();
+                continue;
+            }
+
+            cv::resize(grey, thumb, kThumbSize, 0, 0, cv::INTER_AREA);
+            const bool stable = !reference.empty() && since_detect < opt_.max_skip &&
+                                cv::norm(thumb, reference, cv::NORM_L1) / thumb.total() < opt_.stable_threshold;
+            if (stable) {
+                ++since_detect;
+            } else {
+                p.batch_index = static_cast<int>(batch_.size());
+                batch_.push_back(roi.clone());
+                thumb.copyTo(reference);
+                since_detect = 0;
+            }
+            if (opt_.crops && stable) p.roi = roi.clone();
+            pending_.push_back(std::move(p));
+            if (static_cast<int>(batch_.size()) == opt_.batch) flush();
+        }
+        flush();
+        crops_.release();
+    }
+
+private:
+    struct Pending {
+        size_t row = 0;
+        int batch_index = -1; // -1: reuses the result of the row before it
+        cv::Point origin;
+        cv::Mat roi;          // reuse mode: only kept for crops of reused frames
+        cv::Mat grey;         // track mode only
+    };
+
+    // Runs the batch and resolves the pending rows in frame order, so a reused
+    // row can always copy the (already resolved) row before it.
+    void flush() {
+        if (opt_.track_every > 0) {
+            flush_tracked();
+            return;
+        }
+        detector_.detect(batch_, boxes_);
+        result_->detector_frames += batch_.size();
+        faces_.clear();
+        face_of_.assign(batch_.size(), -1);
+        for (size_t i = 0; i < batch_.size(); ++i) {
+            if (!boxes_[i].found) continue;
+            const cv::Rect face = cv::Rect(boxes_[i].box) & cv::Rect(0, 0, batch_[i].cols, batch_[i].rows);
+            if (face.area() <= 0) {
+                boxes_[i].found = false;
+                continue;
+            }
+            face_of_[i] = static_cast<int>(faces_.size());
+            faces_.push_back(batch_[i](face));
+        }
+        if (emotions_) emotions_->classify(faces_, scores_);
+
+        for (const Pending& p : pending_) {
+            FrameRow& row = result_->rows[p.row];
+            const cv::Mat* roi = &p.roi;
+            if (p.batch_index >= 0) {
+                const FaceBox& face = boxes_[p.batch_index];
+                roi = &batch_[p.batch_index];
+                if (face.found) {
+                    row.x = face.box.x + p.origin.x;
+                    row.y = face.box.y + p.origin.y;
+                    row.w = face.box.width;
+                    row.h = face.box.height;
+                    row.confidence = face.confidence;
+                    row.state = kDetected;
+                    if (emotions_) row.emotion = scores_[face_of_[p.batch_index]];
+                }
+            } else if (p.row > 0) {
+                const FrameRow& prev = result_->rows[p.row - 1];
+                const int64_t offset = row.offset;
+                row = prev;
+                row.offset = offset;
+                if (prev.state != kNoFace) row.state = kReused;
+            }
+            if (crops_.isOpened()) write_crop(row, *roi, p.origin);
+        }
+        pending_.clear();
+        batch_.clear();
+    }
+
+    // Track mode. Scheduled detections come from the batch; frames in between
+    // follow the face with the tracker, and a frame where it loses the face, or
+    // where the tracker could not start on the last face found (too few
+    // corners), is detected on its own right away. Faces of every frame are classified in
+    // one batch at the end.
+    void flush_tracked() {
+        detector_.detect(batch_, boxes_);
+        result_->detector_frames += batch_.size();
+        faces_.clear();
+        face_rows_.clear();
+
+        for (const Pending& p : pending_) {
+            FrameRow& row = result_->rows[p.row];
+            FaceBox face;
+            uint8_t state = kDetected;
+            if (p.batch_index >= 0) {
+                face = boxes_[p.batch_index];
+            } else if (tracker_.active() && tracker_.update(p.grey) && tracker_.confidence() >= opt_.track_confidence) {
+                face.box = tracker_.box();
+                face.confidence = tracker_.confidence();
+                face.found = true;
+                state = kTracked;
+            } else if (face_seen_) {
+                single_.assign(1, p.roi);
+                detector_.detect(single_, single_boxes_);
+                ++result_->detector_frames;
+                face = single_boxes_[0];
+            }
+            if (state == kDetected) {
+                face_seen_ = face.found;
+                if (face.found) {
+                    tracker_.init(p.grey, face.box);
+                } else {
+                    tracker_.reset();
+                }
+            }
+
+            const cv::Rect area = face.found ? cv::Rect(face.box) & cv::Rect(0, 0, p.roi.cols, p.roi.rows) : cv::Rect();
+            if (area.area() > 0) {
+                row.x = face.box.x + p.origin.x;
+                row.y = face.box.y + p.origin.y;
+                row.w = face.box.width;
+                row.h = face.box.height;
+                row.confidence = face.confidence;
+                row.state = state;
+                faces_.push_back(p.roi(area));
+                face_rows_.push_back(p.row);
+            }
+            if (crops_.isOpened()) write_crop(row, p.roi, p.origin);
+        }
+
+        if (emotions_) {
+            emotions_->classify(faces_, scores_);
+            for (size_t i = 0; i < face_rows_.size(); ++i) result_->rows[face_rows_[i]].emotion = scores_[i];
+        }
+        pending_.clear();
+        batch_.clear();
+    }
+
+    void write_crop(const FrameRow& row, const cv::Mat& roi, cv::Point origin) {
+        cv::Mat out(kCropSize, kCropSize, CV_8UC3, cv::Scalar::all(0));
+        if (row.state != kNoFace && !roi.empty()) {
+            const cv::Rect box = cv::Rect(cv::Rect2f(row.x - origin.x, row.y - origin.y, row.w, row.h)) &
+                                 cv::Rect(0, 0, roi.cols, roi.rows);
+            if (box.area() > 0) cv::resize(roi(box), out, out.size());
+        }
+        crops_.write(out); // black when there is no face, to keep frames aligned
+    }
+
+    const Options& opt_;
+    FaceDetector detector_;
+    std::unique_ptr<EmotionClassifier> emotions_;
+    cv::VideoWriter crops_;
+    SegmentResult* result_ = nullptr;
+    RoiTracker tracker_;
+    bool face_seen_ = false; // the last detection found a face (always so while tracking)
+    std::vector<Pending> pending_;
+    std::vector<cv::Mat> batch_;
+    std::vector<FaceBox> boxes_;
+    std::vector<cv::Mat> faces_;
+    std::vector<int> face_of_;
+    std::vector<size_t> face_rows_;
+    std::vector<cv::Mat> single_;
+    std::vector<FaceBox> single_boxes_;
+    std::vector<std::array<float, kEmotionCount>> scores_;
+};
+
+static bool parse_options(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(arg, "--detector") == 0 && has_value) {
+            opt.detector = argv[++i];
+        } else if (std::strcmp(arg, "--detector-config") == 0 && has_value) {
+            opt.detector_config = argv[++i];
+        } else if (std::strcmp(arg, "--emotion") == 0 && has_value) {
+            opt.emotion_model = argv[++i];
+        } else if (std::strcmp(arg, "--out") == 0 && has_value) {
+            opt.out_dir = argv[++i];
+        } else if (std::strcmp(arg, "--crop") == 0 && has_value) {
+            int x, y, w, h;
+            if (std::sscanf(argv[++i], "%d,%d,%d,%d", &x, &y, &w, &h) != 4) return false;
+            opt.crop = cv::Rect(x, y, w, h);
+        } else if (std::strcmp(arg, "--threshold") == 0 && has_value) {
+            opt.threshold = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--threads") == 0 && has_value) {
+            opt.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--batch") == 0 && has_value) {
+            opt.batch = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--stable") == 0 && has_value) {
+            opt.stable_threshold = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--max-skip") == 0 && has_value) {
+            opt.max_skip = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--track") == 0 && has_value) {
+            opt.track_every = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--track-confidence") == 0 && has_value) {
+            opt.track_confidence = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--crops") == 0) {
+            opt.crops = true;
+        } else if (arg[0] == '-') {
+            return false;
+        } else {
+            opt.inputs.push_back(arg);
+        }
+    }
+    return !opt.detector.empty() && !opt.inputs.empty();
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_options(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (::mkdir(opt.out_dir.c_str(), 0755) < 0 && errno != EEXIST) {
+        std::perror(opt.out_dir.c_str());
+        return 1;
+    }
+    if (opt.crops && ::mkdir((opt.out_dir + "/crops").c_str(), 0755) < 0 && errno != EEXIST) {
+        std::perror("crops");
+        return 1;
+    }
+
+    const std::vector<Segment> segments = find_segments(opt.inputs);
+    if (segments.empty()) {
+        std::cerr << "No segments found\n";
+        return 1;
+    }
+    unsigned threads = opt.threads > 0 ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, segments.size());
+    // Parallelism comes from the segments; keep OpenCV from oversubscribing.
+    if (threads > 1) cv::setNumThreads(1);
+
+    std::vector<SegmentResult> results(segments.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            SegmentProcessor processor(opt);
+            for (size_t s = next++; s < segments.size(); s = next++) {
+                char name[32];
+                std::snprintf(name, sizeof(name), "/crops/%05zu.mp4", s);
+                processor.run(segments[s], opt.out_dir + name, results[s]);
+            }
+        });
+    }
+    for (std::thread& w : workers) w.join();
+
+    // Frame times: frames.csv when processing a single recording, else frame / fps.
+    const bool recording = opt.inputs.size() == 1 && segments.front().first_frame >= 0;
+    const std::vector<int64_t> frame_ns = recording ? load_frame_times(opt.inputs.front()) : std::vector<int64_t>();
+
+    size_t total = 0;
+    for (const SegmentResult& r : results) total += r.rows.size();
+    std::vector<int32_t> segment_col;
+    std::vector<int64_t> frame_col, ns_col;
+    std::vector<double> time_col;
+    std::vector<float> x_col, y_col, w_col, h_col, conf_col;
+    std::vector<uint8_t> state_col;
+    std::vector<std::vector<float>> emotion_cols(opt.emotion_model.empty() ? 0 : kEmotionCount);
+    for (auto* col : {&x_col, &y_col, &w_col, &h_col, &conf_col}) col->reserve(total);
+    for (auto& col : emotion_cols) col.reserve(total);
+
+    int64_t next_frame = 0;
+    size_t detected = 0, reused = 0, tracked = 0;
+    int64_t detector_frames = 0;
+    for (size_t s = 0; s < segments.size(); ++s) {
+        const int64_t first = segments[s].first_frame >= 0 ? segments[s].first_frame : next_frame;
+        const double fps = results[s].fps > 0 ? results[s].fps : 30.0;
+        for (const FrameRow& row : results[s].rows) {
+            const int64_t frame = first + row.offset;
+            segment_col.push_back(static_cast<int32_t>(s));
+            frame_col.push_back(frame);
+            if (!frame_ns.empty()) {
+                const int64_t ns = frame < static_cast<int64_t>(frame_ns.size()) ? frame_ns[frame] : -1;
+                ns_col.push_back(ns);
+                time_col.push_back(ns < 0 ? -1.0 : (ns - frame_ns.front()) / 1e9);
+            } else {
+                time_col.push_back(frame / fps);
+            }
+            x_col.push_back(row.x);
+            y_col.push_back(row.y);
+            w_col.push_back(row.w);
+            h_col.push_back(row.h);
+            conf_col.push_back(row.confidence);
+            state_col.push_back(row.state);
+            for (size_t e = 0; e < emotion_cols.size(); ++e) emotion_cols[e].push_back(row.emotion[e]);
+            detected += row.state == kDetected;
+            reused += row.state == kReused;
+            tracked += row.state == kTracked;
+        }
+        detector_frames += results[s].detector_frames;
+        next_frame = first + static_cast<int64_t>(results[s].rows.size());
+    }
+
+    const std::string out = opt.out_dir + "/";
+    bool ok = npy::write(out + "segment.npy", segment_col) && npy::write(out + "frame.npy", frame_col) &&
+              npy::write(out + "timestamp_s.npy", time_col) && npy::write(out + "x.npy", x_col) &&
+              npy::write(out + "y.npy", y_col) && npy::write(out + "w.npy", w_col) && npy::write(out + "h.npy", h_col) &&
+              npy::write(out + "confidence.npy", conf_col) && npy::write(out + "state.npy", state_col);
+    if (!ns_col.empty()) ok = npy::write(out + "monotonic_ns.npy", ns_col) && ok;
+    for (size_t e = 0; e < emotion_cols.size(); ++e) {
+        ok = npy::write(out + kEmotionNames[e] + ".npy", emotion_cols[e]) && ok;
+    }
+
+    std::cout << segments.size() << " segments, " << total << " frames on " << threads << " threads: " << detected
+              << " detected, " << tracked << " tracked, " << reused << " reused, "
+              << (total - detected - tracked - reused) << " without a face; detector ran on " << detector_frames
+              << " frames\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#ifndef NPY_WRITER_H
+#define NPY_WRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Writes one 1-D column as a NumPy .npy file (format 1.0), so the Python side
+// can numpy.load() it directly, or memory-map it with mmap_mode='r'.
+namespace npy {
+
+template <typename T> constexpr const char* descr();
+template <> constexpr const char* descr<int64_t>() { return "<i8"; }
+template <> constexpr const char* descr<int32_t>() { return "<i4"; }
+template <> constexpr const char* descr<uint8_t>() { return "|u1"; }
+template <> constexpr const char* descr<float>() { return "<f4"; }
+template <> constexpr const char* descr<double>() { return "<f8"; }
+
+template <typename T>
+bool write(const std::string& path, const T* data, size_t count) {
+    static_assert(std::is_arithmetic<T>::value, "npy columns are plain numbers");
+    std::string header = "{'descr': '";
+    header += descr<T>();
+    header += "', 'fortran_order': False, 'shape': (" + std::to_string(count) + ",), }";
+    // Magic (6) + version (2) + length (2) + header, padded to 64 bytes with '\n' last.
+    const size_t unpadded = 10 + header.size() + 1;
+    header.append((64 - unpadded % 64) % 64, ' ');
+    header += '\n';
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        std::perror(path.c_str());
+        return false;
+    }
+    const unsigned char preamble[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                                        static_cast<unsigned char>(header.size() & 0xff),
+                                        static_cast<unsigned char>(header.size() >> 8)};
+    bool ok = std::fwrite(preamble, 1, sizeof(preamble), f) == sizeof(preamble) &&
+              std::fwrite(header.data(), 1, header.size(), f) == header.size() &&
+              std::fwrite(data, sizeof(T), count, f) == count;
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) std::perror(path.c_str());
+    return ok;
+}
+
+template <typename T>
+bool write(const std::string& path, const std::vector<T>& column) {
+    return write(path, column.data(), column.size());
+}
+
+} // namespace npy
+
+#endif // NPY_WRITER_H
@@ -0,0 +1,98 @@
+#ifndef ROI_TRACKER_H
+#define ROI_TRACKER_H
+
+#include <algorithm>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+// Carries a detected face box from frame to frame with pyramidal Lucas-Kanade
+// optical flow. Corners are picked inside the box, their median motion moves
+// it, and the share of corners that survive the step is the confidence: when
+// it drops (occlusion, a turn of the head, a cut) the caller runs the detector
+// again. Works on greyscale crops of the analysis ROI, never the full frame.
+class RoiTracker {
+public:
+    static constexpr int kMaxCorners = 40;
+    static constexpr int kMinCorners = 6;
+
+    void reset() {
+        active_ = false;
+        points_.clear();
+    }
+
+    bool active() const { return active_; }
+    const cv::Rect2f& box() const { return box_; }
+    float confidence() const { return confidence_; }
+
+    void init(const cv::Mat& grey, const cv::Rect2f& box) {
+        box_ = box;
+        grey.copyTo(prev_);
+        const cv::Rect area = cv::Rect(box) & cv::Rect(0, 0, grey.cols, grey.rows);
+        points_.clear();
+        if (area.area() > 0) {
+            mask_.create(grey.size(), CV_8U);
+            mask_.setTo(0);
+            mask_(area).setTo(255);
+            cv::goodFeaturesToTrack(grey, points_, kMaxCorners, 0.01, 2.0, mask_);
+        }
+        confidence_ = 1.f;
+        active_ = static_cast<int>(points_.size()) >= kMinCorners;
+    }
+
+    // Returns false when the face is lost and needs a fresh detection.
+    bool update(const cv::Mat& grey) {
+        if (!active_) return false;
+        cv::calcOpticalFlowPyrLK(prev_, grey, points_, next_, status_, error_, cv::Size(15, 15), 2);
+
+        dx_.clear();
+        dy_.clear();
+        size_t kept = 0;
+        const size_t tracked = points_.size();
+        for (size_t i = 0; i < tracked; ++i) {
+            if (!status_[i]) continue;
+            dx_.push_back(next_[i].x - points_[i].x);
+            dy_.push_back(next_[i].y - points_[i].y);
+            points_[kept++] = next_[i];
+        }
+        points_.resize(kept);
+        confidence_ = tracked ? static_cast<float>(kept) / tracked : 0.f;
+        if (static_cast<int>(kept) < kMinCorners) {
+            active_ = false;
+            return false;
+        }
+
+        box_.x += median(dx_);
+        box_.y += median(dy_);
+        grey.copyTo(prev_);
+        // A box that slid out of the ROI is not the face any more.
+        const cv::Rect2f bounds(0, 0, grey.cols, grey.rows);
+        if ((box_ & bounds).area() < 0.5f * box_.area()) {
+            active_ = false;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static float median(std::vector<float>& v) {
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        return v[v.size() / 2];
+    }
+
+    bool active_ = false;
+    cv::Rect2f box_;
+    float confidence_ = 0.f;
+    cv::Mat prev_;
+    cv::Mat mask_;
+    std::vector<cv::Point2f> points_;
+    std::vector<cv::Point2f> next_;
+    std::vector<uchar> status_;
+    std::vector<float> error_;
+    std::vector<float> dx_;
+    std::vector<float> dy_;
+};
+
+#endif // ROI_TRACKER_H
@@ -0,0 +1,171 @@
+#include "experiment_controller.h"
+
+#include <QDebug>
+
+#include "result_writer.h"
+#include "session_clock.h"
+#include "trial_session.h"
+
+ExperimentController::ExperimentController(TrialSession* session, ResultWriter* writer, QObject* parent)
+    : QObject(parent),
+      m_session(session),
+      m_writer(writer) {
+    connect(m_session, &TrialSession::trialFinished, this, &ExperimentController::onTrialFinished);
+    connect(m_session, &TrialSession::finished, this, &ExperimentController::onFinished);
+    connect(m_session, &TrialSession::failed, this, &ExperimentController::onFailed);
+    connect(m_session, &TrialSession::aborted, this, &ExperimentController::onAborted);
+}
+
+bool ExperimentController::arm(const QString& label, const TrialSequence& sequence, const QByteArray& command) {
+    if (m_state == State::Running) {
+        emit rejected("A block is already running, abort it first!");
+        return false;
+    }
+    // Re-arming replaces the pending block and whatever was queued behind it.
+    clearQueue();
+    m_label = label;
+    m_sequence = sequence;
+    m_command = command;
+    m_received = 0;
+    setState(State::Armed);
+    return true;
+}
+
+bool ExperimentController::enqueue(const QString& label, const TrialSequence& sequence, const QByteArray& command) {
+    switch (m_state) {
+    case State::Idle:
+    case State::Done:
+        return arm(label, sequence, command);
+    case State::Armed:
+        break;
+    case State::Running:
+        if (!m_session->queue(command)) {
+            emit rejected("The robot session is not running!");
+            return false;
+        }
+        break;
+    }
+    m_queue.append({label, sequence, command});
+    emit queueChanged(m_queue.size());
+    return true;
+}
+
+bool ExperimentController::start() {
+    switch (m_state) {
+    case State::Running:
+        emit rejected("A block is already running, abort it first!");
+        return false;
+    case State::Idle:
+    case State::Done:
+        emit rejected("Select a block first!");
+        return false;
+    case State::Armed:
+        break;
+    }
+
+    if (!m_session->start(m_command)) {
+        emit rejected("The robot session is still busy!");
+        return false;
+    }
+    // Only a block that really starts gets its header rows in the results file.
+    m_received = 0;
+    m_elapsed.start();
+    m_writer->beginBlock(m_label, m_sequence.seed, sessionClockNs());
+    for (const QueuedBlock& queued : m_queue) {
+        m_session->queue(queued.command);
+    }
+    setState(State::Running);
+    emit blockStarted(m_label);
+    return true;
+}
+
+void ExperimentController::abort() {
+    if (m_state == State::Running) {
+        m_session->abort();
+    } else if (m_state == State::Armed) {
+        clearQueue();
+        setState(State::Idle);
+    }
+}
+
+// Rows are matched to the armed sequence in arrival order. The robot's own
+// trial numbers only cross-check it: whatever the first one is, the rest
+// should count up from it, and a gap or repeat means the conditions of the
+// rows after it may be shifted.
+void ExperimentController::onTrialFinished(const TrialResult& result) {
+    if (m_state != State::Running) {
+        return;
+    }
+    if (m_received >= m_sequence.size) {
+        qDebug() << "Unexpected trial result" << result.trial << "beyond the armed sequence";
+        return;
+    }
+    if (m_received == 0) {
+        m_firstTrial = result.trial;
+    } else if (result.trial != m_firstTrial + static_cast<int>(m_received)) {
+        qWarning() << "Robot reported trial" << result.trial << "as result" << m_received + 1 << "of" << m_label
+                   << "; rows are still paired in arrival order";
+    }
+    // Stamped on arrival so the row can be placed on the video's frame index.
+    const std::int64_t finishedNs = sessionClockNs();
+    const Trial trial = m_sequence[m_received++];
+    m_writer->writeTrial(result, trial, finishedNs);
+    emit trialFinished(result, trial, finishedNs);
+}
+
+void ExperimentController::onFinished() {
+    endBlock("finished");
+    // The robot already has the next command and starts it after its pause.
+    if (m_session->isRunning() && !m_queue.isEmpty()) {
+        beginQueued();
+    }
+}
+
+void ExperimentController::onFailed(const QString& reason) {
+    endBlock("failed", reason);
+    clearQueue();
+}
+
+void ExperimentController::onAborted() {
+    endBlock("aborted");
+    clearQueue();
+}
+
+void ExperimentController::endBlock(const char* outcome, const QString& reason) {
+    if (m_state != State::Running) {
+        return;
+    }
+    m_writer->endBlock(m_label, outcome, m_elapsed.elapsed());
+    // A finished sequence is never re-sent; the next block has to be armed.
+    setState(State::Done);
+    emit blockEnded(m_label, QString::fromLatin1(outcome), reason);
+}
+
+void ExperimentController::beginQueued() {
+    const QueuedBlock next = m_queue.takeFirst();
+    m_label = next.label;
+    m_sequence = next.sequence;
+    m_command = next.command;
+    m_received = 0;
+    m_elapsed.start();
+    m_writer->beginBlock(m_label, m_sequence.seed, sessionClockNs());
+    setState(State::Running);
+    emit queueChanged(m_queue.size());
+    emit blockStarted(m_label);
+}
+
+void ExperimentController::clearQueue() {
+    if (m_queue.isEmpty()) {
+        return;
+    }
+    m_queue.clear();
+    emit queueChanged(0);
+}
+
+void ExperimentController::setState(State state) {
+    if (m_state == state) {
+        return;
+    }
+    m_state = state;
+    emit stateChanged(state);
+}
@@ -0,0 +1,91 @@
+#ifndef EXPERIMENT_CONTROLLER_H
+#define EXPERIMENT_CONTROLLER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include "trial_parser.h"
+#include "trial_sequence.h"
+
+class ResultWriter;
+class TrialSession;
+
+// Owns the one block that can be pending at a time.
+//
+//   Idle --arm()--> Armed --start()--> Running --finished/failed/aborted--> Done
+//                   ^  |                                                    |
+//                   +--+ re-arm replaces the pending block          arm() --+
+//
+// Selecting a block arms it; Start runs the armed block exactly once. Presses
+// that do not fit the current state are rejected rather than queued, so a
+// stale sequence is never sent.
+//
+// enqueue() lines further blocks up behind the armed or running one. Their
+// commands are pipelined to the robot as soon as the session runs, and each
+// queued block becomes the running block (Running -> Done -> Running) when
+// the previous one finishes. A failed or aborted block drops the queue.
+class ExperimentController : public QObject {
+    Q_OBJECT
+
+public:
+    enum class State { Idle, Armed, Running, Done };
+    Q_ENUM(State)
+
+    ExperimentController(TrialSession* session, ResultWriter* writer, QObject* parent = nullptr);
+
+    State state() const { return m_state; }
+    const QString& label() const { return m_label; }
+    const TrialSequence& sequence() const { return m_sequence; }
+
+    bool arm(const QString& label, const TrialSequence& sequence, const QByteArray& command);
+    // Arms when nothing is pending, else queues behind the pending block.
+    bool enqueue(const QString& label, const TrialSequence& sequence, const QByteArray& command);
+    int queued() const { return m_queue.size(); }
+
+public slots:
+    bool start();
+    // Aborts a running block, or disarms a pending one.
+    void abort();
+
+signals:
+    void stateChanged(ExperimentController::State state);
+    void rejected(const QString& reason);
+    void blockStarted(const QString& label);
+    void trialFinished(const TrialResult& result, Trial trial, qint64 finishedNs);
+    void blockEnded(const QString& label, const QString& outcome, const QString& reason);
+    void queueChanged(int queued);
+
+private slots:
+    void onTrialFinished(const TrialResult& result);
+    void onFinished();
+    void onFailed(const QString& reason);
+    void onAborted();
+
+private:
+    void setState(State state);
+    void endBlock(const char* outcome, const QString& reason = QString());
+    void beginQueued();
+    void clearQueue();
+
+    struct QueuedBlock {
+        QString label;
+        TrialSequence sequence;
+        QByteArray command;
+    };
+
+    TrialSession* m_session;
+    ResultWriter* m_writer;
+    State m_state = State::Idle;
+    QString m_label;
+    TrialSequence m_sequence;
+    QByteArray m_command;
+    QList<QueuedBlock> m_queue;
+    size_t m_received = 0;
+    int m_firstTrial = 0; // robot's number for the block's first result
+    QElapsedTimer m_elapsed;
+};
+
+#endif // EXPERIMENT_CONTROLLER_H
@@ -0,0 +1,92 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+// Fixed set of equally sized frame buffers, allocated once. Frames travel
+// between stages as slot indices; every holder of a slot owns one reference
+// and the slot returns to the pool when the last one is released. Buffers are
+// 64-byte aligned and padded so every frame (and row 0 of it) starts on a
+// cache line, which is what the SIMD paths in OpenCV's converters want.
+//
+// acquire() is called by the capture thread only; retain()/release() may be
+// called from any thread.
+class FramePool {
+public:
+    static constexpr std::size_t kAlignment = 64;
+
+    FramePool(int width, int height, int channels, std::size_t count)
+        : m_width(width),
+          m_height(height),
+          m_channels(channels),
+          m_stride(roundUp(static_cast<std::size_t>(width) * channels)),
+          m_frameBytes(roundUp(m_stride * height)),
+          m_count(count),
+          m_refs(new std::atomic<int>[count]),
+          m_free(static_cast<int>(count)) {
+        m_storage = static_cast<std::uint8_t*>(std::aligned_alloc(kAlignment, m_frameBytes * m_count));
+        if (!m_storage) {
+            throw std::bad_alloc();
+        }
+        for (std::size_t i = 0; i < m_count; ++i) {
+            m_refs[i].store(0, std::memory_order_relaxed);
+        }
+    }
+    ~FramePool() { std::free(m_storage); }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Returns a free slot holding one reference, or -1 when all are in use.
+    int acquire() {
+        for (std::size_t n = 0; n < m_count; ++n) {
+            const std::size_t i = (m_next + n) % m_count;
+            if (m_refs[i].load(std::memory_order_acquire) == 0) {
+                m_refs[i].store(1, std::memory_order_relaxed);
+                m_free.fetch_sub(1, std::memory_order_relaxed);
+                m_next = i + 1;
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    void retain(int slot) { m_refs[slot].fetch_add(1, std::memory_order_relaxed); }
+
+    void release(int slot) {
+        if (m_refs[slot].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_free.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint8_t* data(int slot) { return m_storage + static_cast<std::size_t>(slot) * m_frameBytes; }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int channels() const { return m_channels; }
+    std::size_t stride() const { return m_stride; }
+    std::size_t count() const { return m_count; }
+    std::size_t freeCount() const { return static_cast<std::size_t>(m_free.load(std::memory_order_relaxed)); }
+    std::size_t bytes() const { return m_frameBytes * m_count; }
+
+private:
+    static std::size_t roundUp(std::size_t n) { return (n + kAlignment - 1) & ~(kAlignment - 1); }
+
+    int m_width;
+    int m_height;
+    int m_channels;
+    std::size_t m_stride;
+    std::size_t m_frameBytes;
+    std::size_t m_count;
+    std::unique_ptr<std::atomic<int>[]> m_refs;
+    std::atomic<int> m_free;
+    std::uint8_t* m_storage = nullptr;
+    std::size_t m_next = 0;
+};
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,81 @@
+#include "log_view.h"
+
+#include <QScrollBar>
+#include <QTextCursor>
+
+LogView::LogView(QWidget* parent)
+    : QPlainTextEdit(parent),
+      m_flushTimer(new QTimer(this)) {
+    setReadOnly(true);
+    setMaximumBlockCount(kMaxLines);
+    setUndoRedoEnabled(false);
+
+    m_formats[static_cast<size_t>(Tone::Normal)] = QTextCharFormat();
+    m_formats[static_cast<size_t>(Tone::Green)].setForeground(Qt::darkGreen);
+    m_formats[static_cast<size_t>(Tone::Red)].setForeground(Qt::red);
+    m_formats[static_cast<size_t>(Tone::Warning)].setForeground(QColor(0xcc, 0x66, 0x00));
+    m_formats[static_cast<size_t>(Tone::Warning)].setFontWeight(QFont::Bold);
+
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kFlushIntervalMs);
+    connect(m_flushTimer, &QTimer::timeout, this, &LogView::flush);
+}
+
+void LogView::appendLine(const QString& text, Tone tone) {
+    enqueue({text, tone, true});
+}
+
+void LogView::beginLine() {
+    enqueue({QString(), Tone::Normal, true});
+}
+
+void LogView::appendSpan(const QString& text, Tone tone) {
+    enqueue({text, tone, false});
+}
+
+int LogView::linesIn(const Span& span) {
+    return (span.newLine ? 1 : 0) + static_cast<int>(span.text.count('\n'));
+}
+
+void LogView::enqueue(Span span) {
+    m_pendingLines += linesIn(span);
+    m_pending.push_back(std::move(span));
+    // Anything older than the visible history would be trimmed right away;
+    // drop it once the queue holds twice that, keeping the newest kMaxLines.
+    if (m_pendingLines > 2 * kMaxLines) {
+        auto keep = m_pending.begin();
+        while (m_pendingLines > kMaxLines) {
+            m_pendingLines -= linesIn(*keep++);
+        }
+        m_pending.erase(m_pending.begin(), keep);
+    }
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void LogView::flush() {
+    if (m_pending.empty()) {
+        return;
+    }
+    QScrollBar* bar = verticalScrollBar();
+    const bool atBottom = bar->value() == bar->maximum();
+
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    for (const Span& span : m_pending) {
+        if (span.newLine && !m_empty) {
+            cursor.insertBlock();
+        }
+        m_empty = false;
+        cursor.insertText(span.text, m_formats[static_cast<size_t>(span.tone)]);
+    }
+    cursor.endEditBlock();
+    m_pending.clear();
+    m_pendingLines = 0;
+
+    if (atBottom) {
+        bar->setValue(bar->maximum());
+    }
+}
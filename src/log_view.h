@@ -0,0 +1,51 @@
+#ifndef LOG_VIEW_H
+#define LOG_VIEW_H
+
+#include <QPlainTextEdit>
+#include <QString>
+#include <QTextCharFormat>
+#include <QTimer>
+#include <array>
+#include <vector>
+
+// Operator log. Appends are queued and flushed at most once per frame in a
+// single edit block, so a burst of trial results costs one relayout instead
+// of one per token. The document keeps the last kMaxLines lines only.
+class LogView : public QPlainTextEdit {
+    Q_OBJECT
+
+public:
+    enum class Tone : quint8 { Normal, Green, Red, Warning, Count };
+
+    static constexpr int kMaxLines = 5000;
+    static constexpr int kFlushIntervalMs = 16;
+
+    explicit LogView(QWidget* parent = nullptr);
+
+    void appendLine(const QString& text, Tone tone = Tone::Normal);
+    // Starts a new line; following appendSpan() calls continue it.
+    void beginLine();
+    void appendSpan(const QString& text, Tone tone = Tone::Normal);
+
+private slots:
+    void flush();
+
+private:
+    struct Span {
+        QString text;
+        Tone tone;
+        bool newLine;
+    };
+
+    // Lines a span adds to the document, counting embedded newlines.
+    static int linesIn(const Span& span);
+    void enqueue(Span span);
+
+    std::array<QTextCharFormat, static_cast<size_t>(Tone::Count)> m_formats;
+    std::vector<Span> m_pending;
+    int m_pendingLines = 0;
+    QTimer* m_flushTimer;
+    bool m_empty = true;
+};
+
+#endif // LOG_VIEW_H
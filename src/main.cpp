@@ -1,237 +1,203 @@
 #include <QApplication>
 #include <QMainWindow>
-#include <QVBoxLayout>
-#include <QLabel>
-#include <QPushButton>
-#include <QTextEdit>
-#include <QDateTime>
-#include <QTcpSocket>
-#include <QFile>
-#include <QTextStream>
-#include <algorithm>
-#include <vector>
-#include <map>
+#include <QHBoxLayout>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDate>
+#include <QDebug>
+#include <QElapsedTimer>
+#include "log_view.h"
+#include "metrics_server.h"
+#include "schedule_file.h"
+#include "station_panel.h"
+#include "station_registry.h"
+#include "trial_sequence.h"
+#include <cstdio>
+#include <cstdint>
 #include <random>
-#include <string>
+#include <vector>
 
 const QString host = "192.168.0.37";
 const int port = 8888;
+const QString video_stream_url = "http://130.238.16.153:15048/videostream.cgi?loginuse=admin&loginpas=admin";
 
-std::map<int, QString> color_map = {{1, "Green"}, {2, "Green"}, {3, "Red"}, {4, "Red"}};
-std::map<int, bool> trajectory_map = {{1, true}, {2, false}, {3, true}, {4, false}};
-QString clicked_button_label;
-
-void customPrint(const std::vector<int>& sequence, QTextEdit* textWidget) {
-    textWidget->setReadOnly(false);
-    textWidget->append("left ");
-    for (int num : sequence) {
-        QString color = color_map[num];
-        bool trajectory = trajectory_map[num];
-        if (color == "Green") {
-            textWidget->setTextColor(Qt::green);
-            textWidget->append(QString::number(trajectory) + " ");
-        } else {
-            textWidget->setTextColor(Qt::red);
-            textWidget->append(QString::number(trajectory) + " ");
-        }
-    }
-    textWidget->append(" right\n");
-    textWidget->setReadOnly(true);
+std::uint64_t makeSessionSeed() {
+    std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
 }
+SequenceGenerator sequence_generator(makeSessionSeed());
+
+// Optional pre-generated cohort schedule (--schedule/--participant).
+ScheduleFile schedule_file;
+std::uint32_t schedule_participant = 0;
+
+// Headless: --generate-schedule FILE writes every block for a whole cohort.
+int generateSchedule(const QCommandLineParser& parser) {
+    schedule::CohortOptions options;
+    options.participants = parser.value("participants").toUInt();
+    options.baseSeed = parser.isSet("seed") ? parser.value("seed").toULongLong() : makeSessionSeed();
+    options.maxRun = parser.value("max-run").toInt();
+    options.threads = parser.value("threads").toInt();
+
+    QElapsedTimer timer;
+    timer.start();
+    const std::vector<schedule::ScheduleBlock> blocks = schedule::generateCohort(options);
+    const QString path = parser.value("generate-schedule");
+    if (!schedule::writeSchedule(path, options, blocks)) {
+        qCritical() << "Cannot write" << path;
+        return 1;
+    }
 
-std::vector<int> genSeq(int numBlock) {
-    std::vector<int> sequence;
-    switch (numBlock) {
-        case 1:
-            sequence = {1, 3, 1, 3};
-            break;
-        case 2:
-            sequence = {1, 3, 1, 3};
-            break;
-        case 3: {
-            std::vector<int> seq1 = {1, 3, 1, 3, 1, 3, 1, 3};
-            std::vector<int> seq2 = {1, 3, 1, 3, 1, 3, 1, 3};
-            std::random_shuffle(seq1.begin(), seq1.end());
-            std::random_shuffle(seq2.begin(), seq2.end());
-            sequence.insert(sequence.end(), seq1.begin(), seq1.end());
-            sequence.insert(sequence.end(), seq2.begin(), seq2.end());
-            break;
-        }
-        case 4: {
-            std::vector<int> seq1 = {2, 4};
-            std::vector<int> seq2 = {1, 3, 1, 2, 3, 4};
-            std::vector<int> seq3 = {1, 2, 3, 4, 1, 2, 3, 4};
-            std::random_shuffle(seq1.begin(), seq1.end());
-            std::random_shuffle(seq2.begin(), seq2.end());
-            std::random_shuffle(seq3.begin(), seq3.end());
-            sequence.insert(sequence.end(), seq1.begin(), seq1.end());
-            sequence.insert(sequence.end(), seq2.begin(), seq2.end());
-            sequence.insert(sequence.end(), seq3.begin(), seq3.end());
-            break;
-        }
-        case 5: {
-            std::vector<int> seq1 = {1, 3, 1, 3, 1, 3, 1, 3};
-            std::vector<int> seq2 = {1, 3, 1, 3, 1, 3, 1, 3};
-            std::random_shuffle(seq1.begin(), seq1.end());
-            std::random_shuffle(seq2.begin(), seq2.end());
-            sequence.insert(sequence.end(), seq1.begin(), seq1.end());
-            sequence.insert(sequence.end(), seq2.begin(), seq2.end());
-            break;
-        }
+    int unbalanced = 0;
+    for (const schedule::ScheduleBlock& b : blocks) {
+        unbalanced += (b.maxColorRun > options.maxRun || b.maxDirectRun > options.maxRun);
     }
-    std::random_shuffle(sequence.begin(), sequence.end());
-    return sequence;
+    qInfo().noquote() << QString("Wrote %1 participants x %2 blocks to %3 in %4 ms (seed %5, %6 blocks over max run %7)")
+                             .arg(options.participants)
+                             .arg(kBlockCount)
+                             .arg(path)
+                             .arg(timer.elapsed())
+                             .arg(options.baseSeed)
+                             .arg(unbalanced)
+                             .arg(options.maxRun);
+    return 0;
 }
 
-void tcpSendReceived(const QString& data, const std::vector<std::vector<QString>>& seqLog, QTextEdit* textWidget) {
-    textWidget->setReadOnly(false);
-    textWidget->append("Starting actions for " + clicked_button_label + "!\n");
-    textWidget->setReadOnly(true);
-    
-    QTcpSocket socket;
-    socket.connectToHost(host, port);
-    if (!socket.waitForConnected(5000)) {
-        qDebug() << "Connection failed!";
-        return;
+int main(int argc, char *argv[]) {
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) {
+        arguments << QString::fromLocal8Bit(argv[i]);
     }
-    socket.write(data.toUtf8());
-    socket.waitForBytesWritten();
-
-    QByteArray buffer;
-    while (socket.waitForReadyRead(600000)) {
-        buffer.append(socket.readAll());
-        if (buffer.contains("ff")) {
-            QStringList dataSplit = QString(buffer).split(",");
-            std::vector<std::vector<QString>> receivedData;
-            std::vector<QString> dataStr;
-            for (const QString& item : dataSplit) {
-                if (item == "finished") {
-                    receivedData.push_back(dataStr);
-                    dataStr.clear();
-                } else {
-                    dataStr.push_back(item);
-                }
-            }
-            // processAndSaveData(receivedData, seqLog);
-            break;
-        }
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Cobot Malfunction Experiment GUI");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"generate-schedule", "Generate a cohort schedule file and exit.", "file"},
+        {"participants", "Participants to generate.", "n", "24"},
+        {"seed", "Base seed of the generated schedule.", "seed"},
+        {"max-run", "Longest allowed run of one color or of direct/indirect trials.", "n", "3"},
+        {"threads", "Generator threads (0 = one per core).", "n", "0"},
+        {"schedule", "Take block sequences from a schedule file.", "file"},
+        {"participant", "Participant id (1-based) within the schedule.", "id"},
+        {"video-url", "Camera stream recorded during Block 1-3.", "url", video_stream_url},
+        {"video-dir", "Directory for the recordings.", "dir", "video"},
+        {"no-video", "Do not record video."},
+        {"event-log", "Binary event log (default events_<date>.bin).", "file"},
+        {"stations", "Drive every cell listed in a stations.json file.", "file"},
+        {"robot", "Robot of the single cell, e.g. 127.0.0.1:8888 for the emulator.", "host[:port]"},
+        {"block-pause", "Seconds the robot waits before starting a queued block.", "s", "10"},
+        {"no-event-log", "Do not write the event log."},
+        {"metrics-port", "Serve Prometheus metrics on this port (0 = off).", "port", "0"},
+        {"binary-command", "Send block sequences in the binary command format (robot script v2)."},
+        {"terminated-command", "End text block commands with a newline, so blocks can be queued (robot script v2)."},
+    });
+    // Parsed before any QApplication exists so the generator can run headless.
+    if (!parser.parse(arguments)) {
+        fprintf(stderr, "%s\n", qPrintable(parser.errorText()));
+        return 1;
     }
-    socket.close();
-    textWidget->setReadOnly(false);
-    textWidget->append(clicked_button_label + " finished successfully!\n");
-    textWidget->setReadOnly(true);
-}
-
-QString getCurrentDate() {
-    return QDateTime::currentDateTime().toString("yyyy-MM-dd");
-}
-
-QString getCurrentTime() {
-    return QDateTime::currentDateTime().toString("HH:mm:ss");
-}
-
-void logStartTime(const QString& filename) {
-    QFile file(filename);
-    if (file.open(QIODevice::Append)) {
-        QTextStream stream(&file);
-        stream << "Experiment block start time, " << getCurrentTime() << "\n";
-        stream << "Trial no.,Operation time,Color,Trajectory,T/F\n";
+    if (parser.isSet("help")) {
+        fprintf(stdout, "%s", qPrintable(parser.helpText()));
+        return 0;
+    }
+    if (parser.isSet("generate-schedule")) {
+        QCoreApplication app(argc, argv);
+        return generateSchedule(parser);
     }
-}
 
-void processAndSaveData(const std::vector<std::vector<QString>>& receivedData, const std::vector<std::vector<QString>>& seqLog) {
-    QString dataFilename = "data_" + getCurrentDate() + ".csv";
-    QFile file(dataFilename);
-    if (!file.exists()) {
-        file.open(QIODevice::WriteOnly);
-        file.close();
+    QApplication app(argc, argv);
+    if (parser.isSet("schedule")) {
+        if (!schedule_file.open(parser.value("schedule"))) {
+            qCritical() << "Cannot open schedule" << parser.value("schedule") << ":" << schedule_file.errorString();
+            return 1;
+        }
+        // Per station in stations.json; --participant is the default.
+        schedule_participant = parser.value("participant").toUInt();
     }
-    logStartTime(dataFilename);
-    if (file.open(QIODevice::Append)) {
-        QTextStream stream(&file);
-        for (size_t i = 0; i < receivedData.size(); ++i) {
-            float value = receivedData[i][1].toFloat() / 1000;
-            stream << receivedData[i][0] << "," << value << "," << seqLog[i][2] << "," << seqLog[i][3] << "," << seqLog[i][4] << "\n";
+    std::vector<Station> stations;
+    if (parser.isSet("stations")) {
+        StationRegistry registry;
+        if (!registry.load(parser.value("stations"))) {
+            qCritical() << "Cannot load stations" << parser.value("stations") << ":" << registry.errorString();
+            return 1;
+        }
+        stations = registry.stations();
+    } else {
+        Station single;
+        single.robotHost = host;
+        single.robotPort = port;
+        if (parser.isSet("robot")) {
+            const QStringList robot = parser.value("robot").split(':');
+            single.robotHost = robot.value(0);
+            if (robot.size() > 1) {
+                single.robotPort = robot.value(1).toUShort();
+            }
         }
+        single.videoUrl = parser.value("video-url");
+        single.participant = schedule_participant;
+        stations.push_back(single);
     }
-}
-
-std::pair<QString, std::vector<std::vector<QString>>> seqRadom(int numBlock, float waitTime, QTextEdit* textWidget) {
-    std::vector<int> seq = genSeq(numBlock);
-    int lenTrial = seq.size();
-    int halfTrial = lenTrial / 2;
-    std::vector<int> seqUp(seq.begin(), seq.begin() + halfTrial);
-    std::vector<int> seqBottom(seq.begin() + halfTrial, seq.end());
-
-    std::reverse(seqUp.begin(), seqUp.end());
-    std::reverse(seqBottom.begin(), seqBottom.end());
-
-    customPrint(seqUp, textWidget);
-    customPrint(seqBottom, textWidget);
-
-    std::vector<std::vector<QString>> seqLog;
-    QString bits;
-    for (int num : seq) {
-        QString color = color_map[num];
-        bool trajectoryTF = trajectory_map[num];
-        std::vector<QString> log = {color, trajectoryTF ? "true" : "false"};
-        seqLog.push_back(log);
-        bits += (color == "Green" ? (trajectoryTF ? 'z' : 'a') : (trajectoryTF ? 'a' : 'z'));
+    if (schedule_file.isOpen()) {
+        for (Station& station : stations) {
+            if (station.participant == 0) {
+                station.participant = schedule_participant;
+            }
+            if (station.participant < 1 || station.participant > schedule_file.participantCount()) {
+                qCritical().noquote() << (station.name.isEmpty() ? QString("--participant") : "Participant of " + station.name)
+                                      << "must be between 1 and" << schedule_file.participantCount();
+                return 1;
+            }
+        }
     }
-    QString dataSend = QString::number(lenTrial) + "," + bits + "," + QString::number(waitTime);
-    return {dataSend, seqLog};
-}
 
-void onButtonClick(int numBlock, float waitTime, QTextEdit* textWidget, const QString& buttonLabel, QPushButton* startButton) {
-    clicked_button_label = buttonLabel;
-    textWidget->setReadOnly(false);
-    textWidget->append("\nYou have selected " + clicked_button_label + " to play!\n");
-    textWidget->setReadOnly(true);
-    auto [dataSend, seqLog] = seqRadom(numBlock, waitTime, textWidget);
-    textWidget->setReadOnly(false);
-    textWidget->append("Press start when you are ready!\n");
-    textWidget->setReadOnly(true);
-
-    QObject::connect(startButton, &QPushButton::clicked, [=]() {
-        tcpSendReceived(dataSend, seqLog, textWidget);
-    });
-}
+    // Declared before the window so it outlives the panels registered in it.
+    metrics::Registry metrics_registry;
+    const quint16 metrics_port = parser.value("metrics-port").toUShort();
 
-int main(int argc, char *argv[]) {
-    QApplication app(argc, argv);
     QMainWindow window;
     QWidget *centralWidget = new QWidget(&window);
-    QVBoxLayout *layout = new QVBoxLayout(centralWidget);
-
-    QLabel *label = new QLabel("Choose which block you want to run!", centralWidget);
-    layout->addWidget(label);
-
-    QTextEdit *textWidget = new QTextEdit(centralWidget);
-    textWidget->setReadOnly(true);
-    layout->addWidget(textWidget);
-
-    QPushButton *startButton = new QPushButton("", centralWidget);
-
-    std::vector<std::tuple<QString, int, float>> buttonParams = {
-        {"Baseline", 1, 5.0},
-        {"Practice", 2, 5.0},
-        {"Block 1", 3, 5.0},
-        {"Block 2", 4, 5.0},
-        {"Block 3", 5, 5.0}
-    };
+    QHBoxLayout *layout = new QHBoxLayout(centralWidget);
+
+    const QString date = QDate::currentDate().toString("yyyy-MM-dd");
+    std::vector<StationPanel*> panels;
+    for (const Station& station : stations) {
+        StationOptions options;
+        options.schedule = &schedule_file;
+        options.generator = &sequence_generator;
+        options.videoDirectory = parser.value("video-dir");
+        options.recordVideo = !parser.isSet("no-video");
+        options.blockPauseS = parser.value("block-pause").toFloat();
+        options.binaryCommand = parser.isSet("binary-command");
+        options.terminatedCommand = parser.isSet("terminated-command");
+        options.metrics = metrics_port > 0 ? &metrics_registry : nullptr;
+        // Each cell logs to its own file; they merge on the shared monotonic clock.
+        if (!parser.isSet("no-event-log")) {
+            options.eventLogPath = parser.isSet("event-log") && stations.size() == 1
+                                       ? parser.value("event-log")
+                                       : "events_" + (station.name.isEmpty() ? QString() : station.fileTag() + "_") + date + ".bin";
+        }
+        StationPanel *panel = new StationPanel(station, options, centralWidget);
+        layout->addWidget(panel);
+        panels.push_back(panel);
+    }
 
-    for (const auto& params : buttonParams) {
-        QPushButton *button = new QPushButton(std::get<0>(params), centralWidget);
-        QObject::connect(button, &QPushButton::clicked, [=]() {
-            onButtonClick(std::get<1>(params), std::get<2>(params), textWidget, std::get<0>(params), startButton);
-        });
-        layout->addWidget(button);
+    MetricsServer metrics_server(&metrics_registry);
+    if (metrics_port > 0 && !metrics_server.listen(metrics_port)) {
+        qWarning() << "Cannot serve metrics on port" << metrics_port << ":" << metrics_server.errorString();
     }
 
     window.setCentralWidget(centralWidget);
     window.setWindowTitle("Cobot Malfunction Experiment GUI");
     window.show();
 
+    for (StationPanel *panel : panels) {
+        panel->open();
+        if (schedule_file.isOpen()) {
+            panel->log()->appendLine("Schedule " + parser.value("schedule") + ", participant P" + QString::number(panel->station().participant));
+        } else {
+            panel->log()->appendLine("Session seed: " + QString::number(sequence_generator.sessionSeed()));
+        }
+    }
+
     return app.exec();
 }
-
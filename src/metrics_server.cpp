@@ -0,0 +1,42 @@
+#include "metrics_server.h"
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <memory>
+
+static constexpr int kRequestTimeoutMs = 5000;
+
+MetricsServer::MetricsServer(const metrics::Registry* registry, QObject* parent)
+    : QObject(parent),
+      m_registry(registry),
+      m_server(new QTcpServer(this)) {
+    connect(m_server, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen(quint16 port) {
+    return m_server->listen(QHostAddress::Any, port);
+}
+
+QString MetricsServer::errorString() const {
+    return m_server->errorString();
+}
+
+void MetricsServer::onNewConnection() {
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        auto request = std::make_shared<QByteArray>();
+        connect(socket, &QTcpSocket::readyRead, [=, this]() {
+            request->append(socket->readAll());
+            const std::string reply = metrics::http_response(request->constData(), static_cast<size_t>(request->size()), *m_registry);
+            if (!reply.empty()) {
+                socket->write(reply.data(), static_cast<qint64>(reply.size()));
+                socket->disconnectFromHost();
+            }
+        });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        // A client that never finishes its request does not keep the socket.
+        QTimer::singleShot(kRequestTimeoutMs, socket, &QTcpSocket::abort);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <QObject>
+#include <QString>
+
+#include "../common/metrics.h"
+
+class QTcpServer;
+
+// Serves a metrics::Registry as a Prometheus scrape target
+// (http://<host>:<port>/metrics) from the GUI thread. A scrape only reads
+// atomics, so it never holds up a running block.
+class MetricsServer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(const metrics::Registry* registry, QObject* parent = nullptr);
+
+    bool listen(quint16 port);
+    QString errorString() const;
+
+private slots:
+    void onNewConnection();
+
+private:
+    const metrics::Registry* m_registry;
+    QTcpServer* m_server;
+};
+
+#endif // METRICS_SERVER_H
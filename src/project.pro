@@ -1,7 +0,0 @@
-QT += core gui widgets network
-CONFIG += c++11
-TARGET = qt_project
-TEMPLATE = app
-
-SOURCES += main.cpp
-
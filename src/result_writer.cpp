@@ -0,0 +1,98 @@
+#include "result_writer.h"
+
+#include <QDateTime>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+static constexpr int kBufferReserve = 64 * 1024;
+
+static QString getCurrentDate() {
+    return QDateTime::currentDateTime().toString("yyyy-MM-dd");
+}
+
+static QString getCurrentTime() {
+    return QDateTime::currentDateTime().toString("HH:mm:ss");
+}
+
+ResultWriter::ResultWriter(bool durable) : m_durable(durable) {
+    m_buffer.reserve(kBufferReserve);
+}
+
+ResultWriter::~ResultWriter() {
+    flush();
+}
+
+// Keeps one file open per session; only a date change (a session running past
+// midnight) switches to the next day's file.
+bool ResultWriter::ensureOpen() {
+    const QString name = "data_" + (m_station.isEmpty() ? QString() : m_station + "_") + getCurrentDate() + ".csv";
+    if (m_file.isOpen() && m_file.fileName() == name) {
+        return true;
+    }
+    flush();
+    m_file.close();
+    m_file.setFileName(name);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Cannot open" << name << ":" << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// The sequence seed rides along on the start-time row so the row layout the
+// analysis scripts index into stays unchanged.
+bool ResultWriter::beginBlock(const QString& label, quint64 seed, qint64 startNs) {
+    Q_UNUSED(label);
+    if (!ensureOpen()) {
+        return false;
+    }
+    m_buffer.append("Experiment block start time, ").append(getCurrentTime().toUtf8());
+    m_buffer.append(",Sequence seed,").append(QByteArray::number(seed));
+    m_buffer.append(",Monotonic ns,").append(QByteArray::number(startNs)).append('\n');
+    m_buffer.append("Trial no.,Operation time,Color,Trajectory,T/F,Finished at (monotonic ns)\n");
+    if (m_durable) {
+        flush();
+    }
+    return true;
+}
+
+void ResultWriter::writeTrial(const TrialResult& result, Trial trial, qint64 finishedNs) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_buffer.append(QByteArray::number(result.trial)).append(',');
+    m_buffer.append(QByteArray::number(result.operationMs / 1000.0, 'g', 6)).append(',');
+    m_buffer.append(colorName(trial)).append(',');
+    m_buffer.append(isDirect(trial) ? "direct" : "indirect").append(',');
+    // Spelled as the Python GUI wrote it; the analysis scripts match on it.
+    m_buffer.append(trajectory(trial) ? "True" : "False").append(',');
+    m_buffer.append(QByteArray::number(finishedNs)).append('\n');
+    if (m_durable) {
+        flush();
+    }
+}
+
+void ResultWriter::endBlock(const QString& label, const char* outcome, qint64 elapsedMs) {
+    m_buffer.append("Experiment ").append(label.toUtf8()).append(' ').append(outcome);
+    m_buffer.append(" using ").append(QByteArray::number(elapsedMs / 1000.0, 'f', 3)).append(" seconds\n");
+    flush();
+}
+
+void ResultWriter::flush() {
+    if (m_buffer.isEmpty() || !m_file.isOpen()) {
+        return;
+    }
+    if (m_file.write(m_buffer) != m_buffer.size()) {
+        qDebug() << "Short write to" << m_file.fileName() << ":" << m_file.errorString();
+    }
+    m_file.flush();
+#ifdef Q_OS_UNIX
+    if (m_durable) {
+        ::fsync(m_file.handle());
+    }
+#endif
+    m_buffer.resize(0); // keeps the reserved capacity, unlike clear()
+}
@@ -0,0 +1,40 @@
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "trial_parser.h"
+#include "trial_sequence.h"
+
+// Session-scoped writer for data_<date>.csv (data_<station>_<date>.csv when
+// several cells share one GUI). The file is opened once and kept
+// open; rows are formatted into a preallocated buffer and flushed once per
+// block, or after every trial (with fsync) in durable mode.
+class ResultWriter {
+public:
+    explicit ResultWriter(bool durable = false);
+    ~ResultWriter();
+
+    void setDurable(bool durable) { m_durable = durable; }
+    // Takes effect at the next block.
+    void setStation(const QString& tag) { m_station = tag; }
+    QString fileName() const { return m_file.fileName(); }
+
+    // Timestamps are sessionClockNs(), the timebase of the video frame index.
+    bool beginBlock(const QString& label, quint64 seed, qint64 startNs);
+    void writeTrial(const TrialResult& result, Trial trial, qint64 finishedNs);
+    void endBlock(const QString& label, const char* outcome, qint64 elapsedMs);
+
+private:
+    bool ensureOpen();
+    void flush();
+
+    QFile m_file;
+    QByteArray m_buffer;
+    QString m_station;
+    bool m_durable;
+};
+
+#endif // RESULT_WRITER_H
@@ -0,0 +1,97 @@
+#include "robot_link.h"
+
+#include <QDebug>
+
+RobotLink::RobotLink(const QString& host, quint16 port, QObject* parent)
+    : QObject(parent),
+      m_host(host),
+      m_port(port),
+      m_socket(new QTcpSocket(this)),
+      m_connectTimer(new QTimer(this)),
+      m_retryTimer(new QTimer(this)) {
+    m_connectTimer->setSingleShot(true);
+    m_connectTimer->setInterval(link_policy::kConnectTimeoutMs);
+    m_retryTimer->setSingleShot(true);
+
+    connect(m_socket, &QTcpSocket::connected, this, &RobotLink::onConnected);
+    connect(m_socket, &QTcpSocket::disconnected, this, &RobotLink::onDisconnected);
+    connect(m_socket, &QAbstractSocket::errorOccurred, this, &RobotLink::onSocketError);
+    connect(m_connectTimer, &QTimer::timeout, this, &RobotLink::onConnectTimeout);
+    connect(m_retryTimer, &QTimer::timeout, this, &RobotLink::connectNow);
+}
+
+void RobotLink::open() {
+    m_wanted = true;
+    if (m_socket->state() == QAbstractSocket::UnconnectedState && !m_retryTimer->isActive()) {
+        connectNow();
+    }
+}
+
+void RobotLink::close() {
+    m_wanted = false;
+    m_retryTimer->stop();
+    m_connectTimer->stop();
+    m_socket->disconnectFromHost();
+}
+
+void RobotLink::reset() {
+    m_socket->abort(); // emits disconnected() -> linkDown() when the link was up
+    m_connectTimer->stop();
+    m_retryTimer->stop();
+    if (m_wanted) {
+        m_backoff.reset();
+        connectNow();
+    }
+}
+
+void RobotLink::connectNow() {
+    if (!m_wanted || m_socket->state() != QAbstractSocket::UnconnectedState) {
+        return;
+    }
+    m_metrics.connect_attempts.inc();
+    m_socket->connectToHost(m_host, m_port);
+    m_connectTimer->start();
+}
+
+void RobotLink::onConnected() {
+    m_connectTimer->stop();
+    m_backoff.reset();
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    m_socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+    // Qt only toggles SO_KEEPALIVE; the probe timings come from the shared policy.
+    link_policy::tune_socket(static_cast<int>(m_socket->socketDescriptor()));
+    emit linkUp();
+}
+
+void RobotLink::onDisconnected() {
+    m_metrics.link_drops.inc();
+    emit linkDown("Connection closed by robot");
+    scheduleReconnect();
+}
+
+void RobotLink::onSocketError(QAbstractSocket::SocketError error) {
+    if (error == QAbstractSocket::RemoteHostClosedError) {
+        return; // followed by disconnected()
+    }
+    qDebug() << "Robot link error:" << m_socket->errorString();
+    m_connectTimer->stop();
+    if (m_socket->state() != QAbstractSocket::ConnectedState) {
+        m_metrics.connect_failures.inc();
+        m_socket->abort();
+        scheduleReconnect();
+    }
+}
+
+void RobotLink::onConnectTimeout() {
+    qDebug() << "Robot link connect timeout";
+    m_metrics.connect_failures.inc();
+    m_socket->abort();
+    scheduleReconnect();
+}
+
+void RobotLink::scheduleReconnect() {
+    if (!m_wanted || m_retryTimer->isActive()) {
+        return;
+    }
+    m_retryTimer->start(m_backoff.next_ms());
+}
@@ -0,0 +1,58 @@
+#ifndef ROBOT_LINK_H
+#define ROBOT_LINK_H
+
+#include <QObject>
+#include <QString>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "../common/link_policy.h"
+#include "../common/metrics.h"
+
+// Long-lived connection to the Nova5 controller. The link is opened once and
+// kept up for the whole session; dropped links are re-established with
+// exponential backoff so starting a block never pays for a fresh handshake.
+class RobotLink : public QObject {
+    Q_OBJECT
+
+public:
+    RobotLink(const QString& host, quint16 port, QObject* parent = nullptr);
+
+    QTcpSocket* socket() const { return m_socket; }
+    bool isUp() const { return m_socket->state() == QAbstractSocket::ConnectedState; }
+    const QString& host() const { return m_host; }
+    quint16 port() const { return m_port; }
+    // Connection and traffic counters; TrialSession adds the bytes it moves.
+    metrics::LinkMetrics& metrics() { return m_metrics; }
+
+public slots:
+    void open();
+    void close();
+    // Drop the current connection (e.g. to abort a block) and reconnect.
+    void reset();
+
+signals:
+    void linkUp();
+    void linkDown(const QString& reason);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onSocketError(QAbstractSocket::SocketError error);
+    void onConnectTimeout();
+
+private:
+    void connectNow();
+    void scheduleReconnect();
+
+    QString m_host;
+    quint16 m_port;
+    QTcpSocket* m_socket;
+    QTimer* m_connectTimer;
+    QTimer* m_retryTimer;
+    link_policy::Backoff m_backoff;
+    metrics::LinkMetrics m_metrics;
+    bool m_wanted = false;
+};
+
+#endif // ROBOT_LINK_H
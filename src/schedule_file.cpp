@@ -0,0 +1,164 @@
+#include "schedule_file.h"
+
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace schedule {
+
+static constexpr int kMaxAttempts = 4096;
+
+// splitmix64: decorrelates the per-participant/per-block seeds.
+static std::uint64_t mix(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+template <typename Key>
+static int longestRun(const TrialSequence& seq, Key key) {
+    int longest = 0;
+    int run = 0;
+    for (std::size_t i = 0; i < seq.size; ++i) {
+        run = (i > 0 && key(seq[i]) == key(seq[i - 1])) ? run + 1 : 1;
+        longest = std::max(longest, run);
+    }
+    return longest;
+}
+
+static std::uint32_t pack(const TrialSequence& seq) {
+    std::uint32_t packed = 0;
+    for (std::size_t i = 0; i < seq.size; ++i) {
+        packed |= static_cast<std::uint32_t>(seq[i]) << (2 * i);
+    }
+    return packed;
+}
+
+TrialSequence unpack(const ScheduleBlock& block) {
+    TrialSequence seq;
+    seq.block = block.block;
+    seq.seed = block.seed;
+    seq.size = std::min<std::uint8_t>(block.size, kMaxTrials);
+    for (std::size_t i = 0; i < seq.size; ++i) {
+        seq.trials[i] = static_cast<Trial>((block.packedTrials >> (2 * i)) & 3u);
+    }
+    return seq;
+}
+
+// Rejection sampling over seeds: the first shuffle meeting the run limit is
+// kept; if none does within kMaxAttempts the most balanced one seen is used.
+static ScheduleBlock balancedBlock(int numBlock, std::uint64_t seed, int maxRun) {
+    ScheduleBlock best{};
+    int bestWorst = kMaxTrials + 1;
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt, seed = mix(seed)) {
+        const TrialSequence seq = shuffledBlock(numBlock, seed);
+        const int colorRun = longestRun(seq, isGreen);
+        const int directRun = longestRun(seq, isDirect);
+        const int worst = std::max(colorRun, directRun);
+        if (worst < bestWorst) {
+            bestWorst = worst;
+            best.seed = seed;
+            best.block = static_cast<std::uint8_t>(numBlock);
+            best.size = seq.size;
+            best.maxColorRun = static_cast<std::uint8_t>(colorRun);
+            best.maxDirectRun = static_cast<std::uint8_t>(directRun);
+            best.packedTrials = pack(seq);
+        }
+        if (worst <= maxRun) {
+            break;
+        }
+    }
+    return best;
+}
+
+std::vector<ScheduleBlock> generateCohort(const CohortOptions& options) {
+    const std::size_t total = static_cast<std::size_t>(options.participants) * kBlockCount;
+    std::vector<ScheduleBlock> blocks(total);
+
+    unsigned threads = options.threads > 0 ? static_cast<unsigned>(options.threads)
+                                           : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, std::max<std::uint32_t>(1, options.participants));
+
+    auto work = [&](unsigned worker) {
+        for (std::uint32_t p = worker; p < options.participants; p += threads) {
+            for (int b = 1; b <= kBlockCount; ++b) {
+                const std::uint64_t seed = mix(options.baseSeed ^ mix((static_cast<std::uint64_t>(p) << 8) | b));
+                blocks[static_cast<std::size_t>(p) * kBlockCount + (b - 1)] = balancedBlock(b, seed, options.maxRun);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread& t : pool) {
+        t.join();
+    }
+    return blocks;
+}
+
+bool writeSchedule(const QString& path, const CohortOptions& options, const std::vector<ScheduleBlock>& blocks) {
+    ScheduleHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.participantCount = options.participants;
+    header.blockCount = kBlockCount;
+    header.maxTrials = kMaxTrials;
+    header.maxRun = static_cast<std::uint16_t>(options.maxRun);
+    header.baseSeed = options.baseSeed;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(blocks.data()),
+               static_cast<qint64>(blocks.size() * sizeof(ScheduleBlock)));
+    return file.commit();
+}
+
+} // namespace schedule
+
+bool ScheduleFile::open(const QString& path) {
+    m_header = nullptr;
+    m_blocks = nullptr;
+    m_file.close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    const qint64 size = m_file.size();
+    uchar* data = size >= static_cast<qint64>(sizeof(schedule::ScheduleHeader)) ? m_file.map(0, size) : nullptr;
+    if (!data) {
+        m_error = "not a schedule file";
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const schedule::ScheduleHeader*>(data);
+    const qint64 expected = static_cast<qint64>(sizeof(schedule::ScheduleHeader)) +
+                            static_cast<qint64>(header->participantCount) * header->blockCount *
+                                static_cast<qint64>(sizeof(schedule::ScheduleBlock));
+    if (std::memcmp(header->magic, schedule::kMagic, sizeof(schedule::kMagic)) != 0 ||
+        header->version != schedule::kVersion || header->blockCount != kBlockCount || size < expected) {
+        m_error = "unsupported or truncated schedule file";
+        return false;
+    }
+    m_header = header;
+    m_blocks = reinterpret_cast<const schedule::ScheduleBlock*>(data + sizeof(schedule::ScheduleHeader));
+    return true;
+}
+
+bool ScheduleFile::block(std::uint32_t participant, int numBlock, TrialSequence& out) const {
+    if (!m_header || participant < 1 || participant > m_header->participantCount || numBlock < 1 ||
+        numBlock > kBlockCount) {
+        return false;
+    }
+    out = schedule::unpack(m_blocks[static_cast<std::size_t>(participant - 1) * kBlockCount + (numBlock - 1)]);
+    return true;
+}
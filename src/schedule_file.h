@@ -0,0 +1,83 @@
+#ifndef SCHEDULE_FILE_H
+#define SCHEDULE_FILE_H
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+#include "trial_sequence.h"
+
+// Pre-generated, counterbalanced block sequences for a whole cohort.
+//
+// File layout (little endian, fixed size so a participant is found by offset):
+//   ScheduleHeader                       32 bytes
+//   ScheduleBlock[participants][blocks]  16 bytes each, participant 1 first
+//
+// Every block stores the seed it was shuffled from, so shuffledBlock(block, seed)
+// reproduces it and a session can be replayed from the log alone.
+namespace schedule {
+
+static constexpr char kMagic[8] = {'N', '5', 'S', 'C', 'H', 'E', 'D', '\0'};
+static constexpr std::uint32_t kVersion = 1;
+
+struct ScheduleHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t participantCount;
+    std::uint16_t blockCount;
+    std::uint16_t maxTrials;
+    std::uint16_t maxRun;
+    std::uint16_t reserved;
+    std::uint64_t baseSeed;
+};
+static_assert(sizeof(ScheduleHeader) == 32, "on-disk layout");
+
+struct ScheduleBlock {
+    std::uint64_t seed;
+    std::uint8_t block;
+    std::uint8_t size;
+    std::uint8_t maxColorRun;      // longest run of one cube color
+    std::uint8_t maxDirectRun;     // longest run of direct or indirect trials
+    std::uint32_t packedTrials;    // 2 bits per Trial, trial 0 in the low bits
+};
+static_assert(sizeof(ScheduleBlock) == 16, "on-disk layout");
+
+struct CohortOptions {
+    std::uint32_t participants = 24;
+    std::uint64_t baseSeed = 0;
+    int maxRun = 3;
+    int threads = 0; // 0 = one per core
+};
+
+// Generates all blocks for every participant in parallel. Output is
+// deterministic for a given baseSeed regardless of the thread count.
+std::vector<ScheduleBlock> generateCohort(const CohortOptions& options);
+
+bool writeSchedule(const QString& path, const CohortOptions& options, const std::vector<ScheduleBlock>& blocks);
+
+TrialSequence unpack(const ScheduleBlock& block);
+
+} // namespace schedule
+
+// Read-only, memory-mapped view of a schedule file.
+class ScheduleFile {
+public:
+    bool open(const QString& path);
+    bool isOpen() const { return m_header != nullptr; }
+    QString errorString() const { return m_error; }
+
+    std::uint32_t participantCount() const { return m_header ? m_header->participantCount : 0; }
+    std::uint64_t baseSeed() const { return m_header ? m_header->baseSeed : 0; }
+
+    // participant is 1-based (P1, P2, ...), numBlock as in buttonParams.
+    bool block(std::uint32_t participant, int numBlock, TrialSequence& out) const;
+
+private:
+    QFile m_file;
+    const schedule::ScheduleHeader* m_header = nullptr;
+    const schedule::ScheduleBlock* m_blocks = nullptr;
+    QString m_error;
+};
+
+#endif // SCHEDULE_FILE_H
@@ -0,0 +1,16 @@
+#ifndef SESSION_CLOCK_H
+#define SESSION_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+// One monotonic timebase for everything that has to line up afterwards:
+// video frame timestamps, trial results and block start/end rows. On Linux
+// steady_clock is CLOCK_MONOTONIC, the same clock the pump controller logs.
+inline std::int64_t sessionClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+#endif // SESSION_CLOCK_H
@@ -0,0 +1,309 @@
+#include "station_panel.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QLabel>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <vector>
+
+#include "../common/sequence_command.h"
+#include "experiment_controller.h"
+#include "log_view.h"
+#include "robot_link.h"
+#include "schedule_file.h"
+#include "trial_session.h"
+#ifdef NOVA5_HAVE_OPENCV
+#include "video_preview.h"
+#include "video_recorder.h"
+#endif
+
+StationPanel::StationPanel(const Station& station, const StationOptions& options, QWidget* parent)
+    : QWidget(parent),
+      m_station(station),
+      m_options(options),
+      m_log(new LogView(this)),
+      m_link(new RobotLink(station.robotHost, station.robotPort, this)),
+      m_session(new TrialSession(m_link, this)),
+      m_controller(new ExperimentController(m_session, &m_writer, this)) {
+    m_writer.setStation(station.fileTag());
+    if (!options.eventLogPath.isEmpty() &&
+        !m_events.open(QFile::encodeName(options.eventLogPath).constData(), event_log::Source::Gui)) {
+        qWarning() << "Cannot open event log" << options.eventLogPath << ", continuing without it";
+    }
+
+    if (options.metrics) {
+        const std::string cell = metrics::label("station", (station.name.isEmpty() ? QString("default") : station.name).toStdString());
+        metrics::Registry* registry = options.metrics;
+        registry->add_link("nova5_gui_robot", m_link->metrics(), cell);
+        registry->add("nova5_gui_trials_total", "Trial results received from the robot.", m_metrics.trials, cell);
+        registry->add("nova5_gui_trial_operation_seconds", "Robot operation time per trial.", m_metrics.trialTime, cell);
+        registry->add("nova5_gui_blocks_total", "Blocks ended, by outcome.", m_metrics.blocksFinished, cell + ",outcome=\"finished\"");
+        registry->add("nova5_gui_blocks_total", "Blocks ended, by outcome.", m_metrics.blocksFailed, cell + ",outcome=\"failed\"");
+        registry->add("nova5_gui_blocks_total", "Blocks ended, by outcome.", m_metrics.blocksAborted, cell + ",outcome=\"aborted\"");
+        registry->add("nova5_gui_video_frames_total", "Video frames written.", m_metrics.videoFrames, cell);
+        registry->add("nova5_gui_video_dropped_frames_total", "Video frames dropped before encoding.", m_metrics.videoDropped, cell);
+    }
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    const QString prompt = "Choose which block you want to run!";
+    QLabel *label = new QLabel(station.name.isEmpty() ? prompt : station.name + ": " + prompt, this);
+    layout->addWidget(label);
+    layout->addWidget(m_log);
+
+    QPushButton *startButton = new QPushButton("Start", this);
+    QPushButton *abortButton = new QPushButton("Abort", this);
+    LogView *textWidget = m_log;
+    ExperimentController *controller = m_controller;
+    event_log::EventLog *events = &m_events;
+
+    // Logged first, before any handler below touches the GUI.
+    connect(m_link, &RobotLink::linkUp, [=]() { events->append(event_log::Kind::LinkUp); });
+    connect(m_link, &RobotLink::linkDown, [=]() { events->append(event_log::Kind::LinkDown); });
+    connect(m_session, &TrialSession::started, [=]() {
+        events->append(event_log::Kind::CommandSent, controller->sequence().block, controller->sequence().size);
+    });
+    connect(controller, &ExperimentController::blockStarted, [=]() {
+        events->append(event_log::Kind::BlockStart, controller->sequence().block,
+                       static_cast<std::int64_t>(controller->sequence().seed));
+    });
+    connect(controller, &ExperimentController::trialFinished, [=, this](const TrialResult& result, Trial, qint64 finishedNs) {
+        events->append(event_log::Kind::TrialResult, result.trial, result.operationMs, finishedNs);
+        m_metrics.trials.inc();
+        m_metrics.trialTime.observe_ns(static_cast<std::uint64_t>(std::max<qint64>(result.operationMs, 0)) * metrics::kMs);
+    });
+    connect(controller, &ExperimentController::blockEnded, [=, this](const QString&, const QString& outcome) {
+        events->append(event_log::Kind::BlockEnd, controller->sequence().block,
+                       outcome == "finished" ? 0 : outcome == "failed" ? 1 : 2);
+        (outcome == "finished" ? m_metrics.blocksFinished : outcome == "failed" ? m_metrics.blocksFailed : m_metrics.blocksAborted).inc();
+    });
+
+    const QString robot = station.robotHost + ":" + QString::number(station.robotPort);
+    connect(m_link, &RobotLink::linkUp, [=]() {
+        textWidget->appendLine("Connected to robot at " + robot);
+    });
+    connect(m_link, &RobotLink::linkDown, [=](const QString& reason) {
+        textWidget->appendLine("Robot link down: " + reason + ", reconnecting...", LogView::Tone::Warning);
+    });
+
+    connect(controller, &ExperimentController::rejected, [=](const QString& reason) {
+        textWidget->appendLine(reason + "\n", LogView::Tone::Warning);
+    });
+    connect(controller, &ExperimentController::blockStarted, [=](const QString& blockLabel) {
+        textWidget->appendLine("Starting actions for " + blockLabel + "!\n");
+    });
+    connect(controller, &ExperimentController::trialFinished, [=](const TrialResult& result, Trial, qint64) {
+        textWidget->appendLine("Trial " + QString::number(result.trial) + " finished in " + QString::number(result.operationMs / 1000.0) + " s");
+    });
+    connect(controller, &ExperimentController::blockEnded, [=](const QString& blockLabel, const QString& outcome, const QString& reason) {
+        if (outcome == "finished") {
+            textWidget->appendLine(blockLabel + " finished successfully!\n");
+        } else if (outcome == "failed") {
+            qDebug() << station.name << reason;
+            textWidget->appendLine(blockLabel + " failed: " + reason + "\n", LogView::Tone::Warning);
+        } else {
+            textWidget->appendLine(blockLabel + " aborted!\n");
+        }
+    });
+#ifdef NOVA5_HAVE_OPENCV
+    if (options.recordVideo && !station.videoUrl.isEmpty()) {
+        VideoRecorderConfig videoConfig;
+        videoConfig.url = station.videoUrl;
+        // Cells get their own tree so recordings started in the same second never collide.
+        videoConfig.directory = station.name.isEmpty() ? options.videoDirectory
+                                                       : options.videoDirectory + "/" + station.fileTag();
+        VideoRecorder *recorder = m_recorder = new VideoRecorder(videoConfig, this);
+        recorder->setCounters(&m_metrics.videoFrames, &m_metrics.videoDropped);
+        VideoPreview *preview = new VideoPreview(this);
+        layout->insertWidget(1, preview);
+        connect(recorder, &VideoRecorder::previewFrame, preview, &VideoPreview::setFrame);
+        connect(recorder, &VideoRecorder::error, [=](const QString& reason) {
+            textWidget->appendLine("Video: " + reason, LogView::Tone::Warning);
+        });
+        connect(recorder, &VideoRecorder::stopped, [=, this](const QString& fileName, bool kept, qint64 frames, qint64 dropped) {
+            preview->clear();
+            textWidget->appendLine(QString("Video %1: %2 frames, %3 dropped%4").arg(fileName).arg(frames).arg(dropped).arg(kept ? "" : " (too short, deleted)"));
+            if (!m_pendingRecording.isEmpty()) {
+                recorder->start(m_pendingRecording);
+                m_pendingRecording.clear();
+            }
+        });
+        // Only the experiment blocks are recorded, never Baseline or Practice.
+        // A queued block starts right as the last one ends, usually before
+        // that recording has closed; it is then started from stopped().
+        connect(controller, &ExperimentController::blockStarted, [=, this]() {
+            if (controller->sequence().block > 2 && !recorder->start(controller->label())) {
+                if (recorder->isRecording()) {
+                    m_pendingRecording = controller->label();
+                } else {
+                    textWidget->appendLine("Video: cannot start recording this block", LogView::Tone::Warning);
+                }
+            }
+        });
+        // The robot reports each trial's duration, so its span ends on arrival.
+        connect(controller, &ExperimentController::trialFinished, [=](const TrialResult& result, Trial, qint64 finishedNs) {
+            recorder->markTrial(result.trial, finishedNs - result.operationMs * 1000000, finishedNs);
+        });
+        connect(controller, &ExperimentController::blockEnded, recorder, &VideoRecorder::stop);
+    }
+#endif
+    connect(controller, &ExperimentController::queueChanged, [=, this](int queued) {
+        if (queued > 0) {
+            textWidget->appendLine(QString::number(queued) + " block(s) queued, each starts " +
+                                   QString::number(m_options.blockPauseS) + " s after the previous one");
+        }
+    });
+    connect(controller, &ExperimentController::stateChanged, [=](ExperimentController::State state) {
+        startButton->setEnabled(state == ExperimentController::State::Armed);
+        abortButton->setEnabled(state == ExperimentController::State::Armed || state == ExperimentController::State::Running);
+    });
+    connect(startButton, &QPushButton::clicked, [=]() { events->append(event_log::Kind::ButtonPress, 0); });
+    connect(abortButton, &QPushButton::clicked, [=]() { events->append(event_log::Kind::ButtonPress, -1); });
+    // Connected once: Start always runs whatever block is armed right now.
+    connect(startButton, &QPushButton::clicked, controller, &ExperimentController::start);
+    connect(abortButton, &QPushButton::clicked, controller, &ExperimentController::abort);
+    startButton->setEnabled(false);
+    abortButton->setEnabled(false);
+
+    std::vector<std::tuple<QString, int, float>> buttonParams = {
+        {"Baseline", 1, 5.0},
+        {"Practice", 2, 5.0},
+        {"Block 1", 3, 5.0},
+        {"Block 2", 4, 5.0},
+        {"Block 3", 5, 5.0}
+    };
+
+    for (const auto& params : buttonParams) {
+        QPushButton *button = new QPushButton(std::get<0>(params), this);
+        connect(button, &QPushButton::clicked, [=, this]() {
+            events->append(event_log::Kind::ButtonPress, std::get<1>(params));
+            selectBlock(std::get<1>(params), std::get<2>(params), std::get<0>(params));
+        });
+        layout->addWidget(button);
+    }
+    // Blocks 1-3 back to back: armed together, started with one press of Start.
+    QPushButton *queueButton = new QPushButton("Block 1-3", this);
+    connect(queueButton, &QPushButton::clicked, [=, this]() {
+        events->append(event_log::Kind::ButtonPress, 6);
+        queueBlocks(5.0);
+    });
+    layout->addWidget(queueButton);
+    layout->addWidget(startButton);
+    layout->addWidget(abortButton);
+}
+
+void StationPanel::open() {
+    m_link->open();
+}
+
+void StationPanel::printTrials(const Trial* begin, const Trial* end) {
+    m_log->appendLine("left ");
+    for (const Trial* t = begin; t != end; ++t) {
+        m_log->appendSpan(QString::number(trajectory(*t)) + " ", isGreen(*t) ? LogView::Tone::Green : LogView::Tone::Red);
+    }
+    m_log->appendSpan(" right");
+}
+
+TrialSequence StationPanel::nextSequence(int numBlock) {
+    TrialSequence seq;
+    const ScheduleFile* schedule = m_options.schedule;
+    if (!schedule || !schedule->isOpen() || !schedule->block(m_station.participant, numBlock, seq)) {
+        seq = m_options.generator->next(numBlock);
+    }
+    int lenTrial = seq.size;
+    int halfTrial = lenTrial / 2;
+
+    // Both halves are shown mirrored, as the cubes are laid out facing the operator.
+    std::array<Trial, kMaxTrials> mirrored;
+    std::reverse_copy(seq.begin(), seq.begin() + halfTrial, mirrored.begin());
+    std::reverse_copy(seq.begin() + halfTrial, seq.end(), mirrored.begin() + halfTrial);
+
+    printTrials(mirrored.data(), mirrored.data() + halfTrial);
+    printTrials(mirrored.data() + halfTrial, mirrored.data() + lenTrial);
+
+    m_log->appendLine("Sequence seed: " + QString::number(seq.seed));
+    return seq;
+}
+
+QByteArray StationPanel::commandFor(const TrialSequence& seq, float waitTime, float pauseS) const {
+    if (m_options.binaryCommand) {
+        seq_cmd::Command cmd;
+        cmd.block = seq.block;
+        cmd.count = seq.size;
+        cmd.wait_ms = static_cast<std::uint32_t>(waitTime * 1000.0f + 0.5f);
+        cmd.pause_ms = pauseS < 0 ? 0 : static_cast<std::uint32_t>(pauseS * 1000.0f + 0.5f);
+        cmd.seed = seq.seed;
+        for (int i = 0; i < seq.size; ++i) {
+            cmd.trials[i] = static_cast<std::uint8_t>(seq.trials[i]);
+        }
+        QByteArray frame(static_cast<int>(seq_cmd::encoded_size(cmd.count)), Qt::Uninitialized);
+        seq_cmd::encode(cmd, reinterpret_cast<std::uint8_t*>(frame.data()));
+        return frame;
+    }
+    QString bits;
+    bits.reserve(seq.size);
+    for (Trial t : seq) {
+        bits += isDirect(t) ? 'z' : 'a';
+    }
+    QString dataSend = QString::number(seq.size) + "," + bits + "," + QString::number(waitTime);
+    if (pauseS >= 0) {
+        dataSend += "," + QString::number(pauseS);
+    }
+    // Pipelined commands can share one TCP segment; the newline keeps them
+    // apart. The original robot script reads one unterminated command per read.
+    if (m_options.terminatedCommand) {
+        dataSend += "\n";
+    }
+    return dataSend.toUtf8();
+}
+
+bool StationPanel::canQueue() const {
+    if (m_options.binaryCommand || m_options.terminatedCommand) {
+        return true;
+    }
+    m_log->appendLine("Queued blocks need --terminated-command or --binary-command!\n", LogView::Tone::Warning);
+    return false;
+}
+
+void StationPanel::selectBlock(int numBlock, float waitTime, const QString& buttonLabel) {
+    if (m_controller->state() == ExperimentController::State::Running) {
+        // Experiment blocks can follow the running one; the robot gets the
+        // sequence now and starts it on its own after the pause.
+        if (numBlock <= 2) {
+            m_log->appendLine("A block is already running, abort it first!\n", LogView::Tone::Warning);
+            return;
+        }
+        if (!canQueue()) {
+            return;
+        }
+        m_log->appendLine("\nQueued " + buttonLabel + " after " + m_controller->label() + "\n");
+        TrialSequence seq = nextSequence(numBlock);
+        m_controller->enqueue(buttonLabel, seq, commandFor(seq, waitTime, m_options.blockPauseS));
+        return;
+    }
+    m_log->appendLine("\nYou have selected " + buttonLabel + " to play!\n");
+    TrialSequence seq = nextSequence(numBlock);
+    if (m_controller->arm(buttonLabel, seq, commandFor(seq, waitTime, -1))) {
+        m_log->appendLine("Press start when you are ready!\n");
+    }
+}
+
+void StationPanel::queueBlocks(float waitTime) {
+    if (m_controller->state() == ExperimentController::State::Running) {
+        m_log->appendLine("A block is already running, abort it first!\n", LogView::Tone::Warning);
+        return;
+    }
+    selectBlock(3, waitTime, "Block 1");
+    if (!canQueue()) {
+        return;
+    }
+    for (int numBlock = 4; numBlock <= 5; ++numBlock) {
+        const QString label = "Block " + QString::number(numBlock - 2);
+        m_log->appendLine("\nQueued " + label + "\n");
+        TrialSequence seq = nextSequence(numBlock);
+        m_controller->enqueue(label, seq, commandFor(seq, waitTime, m_options.blockPauseS));
+    }
+}
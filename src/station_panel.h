@@ -0,0 +1,92 @@
+#ifndef STATION_PANEL_H
+#define STATION_PANEL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QWidget>
+
+#include "../common/event_log.h"
+#include "../common/metrics.h"
+#include "result_writer.h"
+#include "station_registry.h"
+#include "trial_sequence.h"
+
+class ExperimentController;
+class LogView;
+class RobotLink;
+class ScheduleFile;
+class TrialSession;
+#ifdef NOVA5_HAVE_OPENCV
+class VideoRecorder;
+#endif
+
+struct StationOptions {
+    const ScheduleFile* schedule = nullptr; // may be null or closed
+    SequenceGenerator* generator = nullptr;
+    QString videoDirectory;
+    bool recordVideo = true;
+    QString eventLogPath;                   // empty: no event log
+    float blockPauseS = 10.0f;              // robot pause before a queued block
+    bool binaryCommand = false;             // send common/sequence_command.h frames instead of text
+    bool terminatedCommand = false;         // end text commands with a newline so they can be queued
+    metrics::Registry* metrics = nullptr;   // where the cell's counters are exported, if anywhere
+};
+
+// Per-cell counters behind the GUI's metrics endpoint; the robot link keeps
+// its own (RobotLink::metrics()).
+struct StationMetrics {
+    metrics::Counter trials;
+    metrics::Counter blocksFinished;
+    metrics::Counter blocksFailed;
+    metrics::Counter blocksAborted;
+    metrics::Histogram trialTime = metrics::trial_histogram();
+    metrics::Counter videoFrames;
+    metrics::Counter videoDropped;
+};
+
+// Everything one Nova5 cell needs: robot link, trial session, controller,
+// result writer, event log and (with OpenCV) its camera, plus the block
+// buttons and log view that drive it. Panels share the GUI thread's event
+// loop; every robot session is asynchronous, so one process runs any number
+// of cells side by side.
+class StationPanel : public QWidget {
+    Q_OBJECT
+
+public:
+    StationPanel(const Station& station, const StationOptions& options, QWidget* parent = nullptr);
+
+    const Station& station() const { return m_station; }
+    LogView* log() const { return m_log; }
+    ExperimentController* controller() const { return m_controller; }
+
+public slots:
+    // Connects to the robot and keeps the link up.
+    void open();
+
+private:
+    void selectBlock(int numBlock, float waitTime, const QString& buttonLabel);
+    void queueBlocks(float waitTime);
+    TrialSequence nextSequence(int numBlock);
+    // Robot command for seq; pauseS < 0 starts it at once, otherwise it is
+    // queued and starts pauseS after the previous block.
+    QByteArray commandFor(const TrialSequence& seq, float waitTime, float pauseS) const;
+    // Warns and returns false when the command format cannot be pipelined.
+    bool canQueue() const;
+    void printTrials(const Trial* begin, const Trial* end);
+
+    Station m_station;
+    StationOptions m_options;
+    LogView* m_log;
+    RobotLink* m_link;
+    TrialSession* m_session;
+    ResultWriter m_writer;
+    ExperimentController* m_controller;
+    event_log::EventLog m_events;
+    StationMetrics m_metrics;
+#ifdef NOVA5_HAVE_OPENCV
+    VideoRecorder* m_recorder = nullptr;
+    QString m_pendingRecording; // queued block that started while the last recording was closing
+#endif
+};
+
+#endif // STATION_PANEL_H
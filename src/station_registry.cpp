@@ -0,0 +1,68 @@
+#include "station_registry.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+
+QString Station::fileTag() const {
+    QString tag;
+    tag.reserve(name.size());
+    for (QChar c : name) {
+        tag += (c.isLetterOrNumber() && c.unicode() < 128) || c == '-' ? c : QChar('_');
+    }
+    return tag;
+}
+
+bool StationRegistry::load(const QString& path) {
+    m_stations.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull()) {
+        m_error = parseError.errorString();
+        return false;
+    }
+    const QJsonArray list = doc.object().value("stations").toArray();
+    if (list.isEmpty()) {
+        m_error = "no \"stations\" listed";
+        return false;
+    }
+
+    QSet<QString> tags;
+    for (const QJsonValue& value : list) {
+        const QJsonObject o = value.toObject();
+        Station s;
+        s.name = o.value("name").toString();
+        s.robotHost = o.value("host").toString();
+        // Absent means the default; anything but an integer in range is an error.
+        const QJsonValue portValue = o.value("port");
+        const int port = portValue.isUndefined() ? 8888 : portValue.toInt(0);
+        s.pumpHost = o.value("pump").toString();
+        s.videoUrl = o.value("video").toString();
+        s.participant = static_cast<std::uint32_t>(o.value("participant").toInt(0));
+        if (s.name.isEmpty() || s.robotHost.isEmpty()) {
+            m_error = QString("station %1 needs a name and a host").arg(m_stations.size() + 1);
+            return false;
+        }
+        if (port < 1 || port > 65535) {
+            m_error = "station " + s.name + " needs a port from 1 to 65535";
+            return false;
+        }
+        s.robotPort = static_cast<quint16>(port);
+        // Two cells writing data_<tag>_<date>.csv would interleave their blocks.
+        if (tags.contains(s.fileTag())) {
+            m_error = "duplicate station " + s.name;
+            return false;
+        }
+        tags.insert(s.fileTag());
+        m_stations.push_back(s);
+    }
+    m_error.clear();
+    return true;
+}
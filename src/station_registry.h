@@ -0,0 +1,38 @@
+#ifndef STATION_REGISTRY_H
+#define STATION_REGISTRY_H
+
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+// One Nova5 cell: its robot controller, the Pi running its pump controller
+// (informational, pump_control connects to the robot by itself) and its camera.
+struct Station {
+    QString name;                   // shown on the panel, e.g. "Cell A"
+    QString robotHost;
+    quint16 robotPort = 8888;
+    QString pumpHost;
+    QString videoUrl;               // empty: the cell is not recorded
+    std::uint32_t participant = 0;  // schedule participant, 0 = random sequences
+
+    // name reduced to [A-Za-z0-9_-], used in result, event and video paths.
+    QString fileTag() const;
+};
+
+// Cells listed in a stations.json file:
+//   { "stations": [ { "name": "Cell A", "host": "192.168.0.37", "port": 8888,
+//                     "pump": "192.168.0.41", "video": "http://...",
+//                     "participant": 1 }, ... ] }
+// Only name and host are required; names must be unique.
+class StationRegistry {
+public:
+    bool load(const QString& path);
+    QString errorString() const { return m_error; }
+    const std::vector<Station>& stations() const { return m_stations; }
+
+private:
+    std::vector<Station> m_stations;
+    QString m_error;
+};
+
+#endif // STATION_REGISTRY_H
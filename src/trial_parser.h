@@ -0,0 +1,129 @@
+#ifndef TRIAL_PARSER_H
+#define TRIAL_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct TrialResult {
+    int trial = 0;
+    std::int64_t operationMs = 0;
+};
+
+// Incremental tokenizer for the robot's result stream:
+//
+//     <trial>,<ms>,finished,<trial>,<ms>,finished,...,ff
+//
+// Bytes are consumed straight out of the caller's read buffer. A field that is
+// split across two reads is carried over in the parser state (a running
+// integer or a short keyword prefix), so nothing is ever rescanned or copied
+// and each record is reported the moment its "finished" keyword completes.
+// A number longer than kMaxDigits is a protocol error: the parser stops there
+// and failed() stays true until reset().
+class TrialStreamParser {
+public:
+    // Feeds len bytes and calls onTrial(const TrialResult&) for every complete
+    // record. Returns the number of bytes consumed; that is less than len only
+    // when the "ff" terminator was reached, in which case blockEnded() is true
+    // and the remaining bytes belong to whatever the robot sends next, or when
+    // failed() became true.
+    template <typename OnTrial>
+    std::size_t feed(const char* data, std::size_t len, OnTrial&& onTrial) {
+        std::size_t i = 0;
+        while (i < len && !m_ended && !m_failed) {
+            const char c = data[i++];
+            if (c == ',' || c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                endField();
+            } else if (c >= '0' && c <= '9' && m_wordLen == 0) {
+                if (m_digits == kMaxDigits) {
+                    m_failed = true;
+                    break;
+                }
+                m_value = m_value * 10 + (c - '0');
+                ++m_digits;
+                m_inNumber = true;
+            } else {
+                pushWordChar(c);
+                if (matchesWord("finished")) {
+                    if (m_numberCount >= 2) {
+                        TrialResult result;
+                        result.trial = static_cast<int>(m_numbers[0]);
+                        result.operationMs = m_numbers[1];
+                        onTrial(result);
+                    }
+                    m_numberCount = 0;
+                    clearField();
+                } else if (matchesWord("ff")) {
+                    m_ended = true;
+                    m_numberCount = 0;
+                    clearField();
+                }
+            }
+        }
+        return i;
+    }
+
+    bool blockEnded() const { return m_ended; }
+    bool failed() const { return m_failed; }
+
+    void reset() {
+        m_numberCount = 0;
+        m_ended = false;
+        m_failed = false;
+        clearField();
+    }
+
+private:
+    static constexpr int kMaxWord = 8;
+    // Trial numbers and durations in ms (over eleven days at this length) all
+    // fit, and so does their int conversion.
+    static constexpr int kMaxDigits = 9;
+
+    void endField() {
+        if (m_inNumber && m_wordLen == 0 && m_numberCount < 2) {
+            m_numbers[m_numberCount++] = m_value;
+        }
+        clearField();
+    }
+
+    void clearField() {
+        m_value = 0;
+        m_digits = 0;
+        m_inNumber = false;
+        m_wordLen = 0;
+    }
+
+    void pushWordChar(char c) {
+        // Digits followed by letters ("12ab") are not a number; anything longer
+        // than the longest keyword can never match and is simply dropped.
+        m_inNumber = false;
+        if (m_wordLen < kMaxWord) {
+            m_word[m_wordLen] = c;
+        }
+        ++m_wordLen;
+    }
+
+    template <std::size_t N>
+    bool matchesWord(const char (&word)[N]) const {
+        if (m_wordLen != static_cast<int>(N - 1)) {
+            return false;
+        }
+        for (std::size_t k = 0; k + 1 < N; ++k) {
+            if (m_word[k] != word[k]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::int64_t m_numbers[2] = {0, 0};
+    int m_numberCount = 0;
+    std::int64_t m_value = 0;
+    int m_digits = 0;
+    bool m_inNumber = false;
+    char m_word[kMaxWord] = {};
+    int m_wordLen = 0;
+    bool m_ended = false;
+    bool m_failed = false;
+};
+
+#endif // TRIAL_PARSER_H
@@ -0,0 +1,20 @@
+#include "trial_sequence.h"
+
+TrialSequence shuffledBlock(int numBlock, std::uint64_t seed) {
+    TrialSequence seq;
+    seq.seed = seed;
+    const BlockDefinition* def = blockDefinition(numBlock);
+    if (!def) {
+        return seq;
+    }
+    seq.block = static_cast<std::uint8_t>(numBlock);
+    seq.size = def->size;
+    seq.trials = def->trials;
+
+    std::mt19937_64 rng(seed);
+    for (std::size_t i = seq.size; i > 1; --i) {
+        const std::size_t j = static_cast<std::size_t>(rng() % i);
+        std::swap(seq.trials[i - 1], seq.trials[j]);
+    }
+    return seq;
+}
@@ -0,0 +1,82 @@
+#ifndef TRIAL_SEQUENCE_H
+#define TRIAL_SEQUENCE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// A trial packed into two bits: bit 1 = red cube, bit 0 = false trajectory.
+// The value is the old genSeq code minus one (1 = Green/true ... 4 = Red/false).
+enum class Trial : std::uint8_t {
+    GreenTrue  = 0,
+    GreenFalse = 1,
+    RedTrue    = 2,
+    RedFalse   = 3,
+};
+
+constexpr bool isGreen(Trial t) { return (static_cast<std::uint8_t>(t) & 2) == 0; }
+constexpr bool trajectory(Trial t) { return (static_cast<std::uint8_t>(t) & 1) == 0; }
+// Green cubes go direct on a true trajectory, red ones on a false one.
+constexpr bool isDirect(Trial t) { return isGreen(t) == trajectory(t); }
+constexpr const char* colorName(Trial t) { return isGreen(t) ? "Green" : "Red"; }
+
+static constexpr std::size_t kMaxTrials = 16;
+static constexpr int kBlockCount = 5;
+
+struct BlockDefinition {
+    std::uint8_t size;
+    std::array<Trial, kMaxTrials> trials;
+};
+
+namespace blocks {
+using T = Trial;
+constexpr Trial G1 = T::GreenTrue, G0 = T::GreenFalse, R1 = T::RedTrue, R0 = T::RedFalse;
+
+// Trial multisets per block (1 = Baseline ... 5 = Block 3). Every block is
+// shuffled as a whole, so the sub-groups genSeq used to shuffle separately
+// first did not change the resulting distribution and are not kept.
+constexpr std::array<BlockDefinition, kBlockCount> kDefinitions = {{
+    {4,  {G1, R1, G1, R1}},
+    {4,  {G1, R1, G1, R1}},
+    {16, {G1, R1, G1, R1, G1, R1, G1, R1, G1, R1, G1, R1, G1, R1, G1, R1}},
+    {16, {G0, R0, G1, R1, G1, G0, R1, R0, G1, G0, R1, R0, G1, G0, R1, R0}},
+    {16, {G1, R1, G1, R1, G1, R1, G1, R1, G1, R1, G1, R1, G1, R1, G1, R1}},
+}};
+} // namespace blocks
+
+// numBlock is 1-based as in buttonParams; nullptr when out of range.
+constexpr const BlockDefinition* blockDefinition(int numBlock) {
+    return (numBlock >= 1 && numBlock <= kBlockCount) ? &blocks::kDefinitions[numBlock - 1] : nullptr;
+}
+
+struct TrialSequence {
+    std::array<Trial, kMaxTrials> trials{};
+    std::uint8_t size = 0;
+    std::uint8_t block = 0;
+    std::uint64_t seed = 0;
+
+    const Trial* begin() const { return trials.data(); }
+    const Trial* end() const { return trials.data() + size; }
+    Trial operator[](std::size_t i) const { return trials[i]; }
+};
+
+// Shuffles one block from a 64-bit seed. The Fisher-Yates reduction is done
+// here rather than through std::shuffle/uniform_int_distribution, whose output
+// is implementation-defined, so a logged seed replays the same order anywhere.
+TrialSequence shuffledBlock(int numBlock, std::uint64_t seed);
+
+// Hands out per-block seeds from one session seed.
+class SequenceGenerator {
+public:
+    explicit SequenceGenerator(std::uint64_t sessionSeed) : m_sessionSeed(sessionSeed), m_rng(sessionSeed) {}
+
+    std::uint64_t sessionSeed() const { return m_sessionSeed; }
+    TrialSequence next(int numBlock) { return shuffledBlock(numBlock, m_rng()); }
+
+private:
+    std::uint64_t m_sessionSeed;
+    std::mt19937_64 m_rng;
+};
+
+#endif // TRIAL_SEQUENCE_H
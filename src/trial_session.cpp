@@ -0,0 +1,159 @@
+#include "trial_session.h"
+
+#include "robot_link.h"
+
+static constexpr int kConnectTimeoutMs = 5000;
+static constexpr int kIdleTimeoutMs = 600000;
+
+TrialSession::TrialSession(RobotLink* link, QObject* parent)
+    : QObject(parent),
+      m_link(link),
+      m_connectTimer(new QTimer(this)),
+      m_idleTimer(new QTimer(this)) {
+    m_connectTimer->setSingleShot(true);
+    m_connectTimer->setInterval(kConnectTimeoutMs);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(kIdleTimeoutMs);
+
+    connect(m_link, &RobotLink::linkUp, this, &TrialSession::onLinkUp);
+    connect(m_link, &RobotLink::linkDown, this, &TrialSession::onLinkDown);
+    connect(m_link->socket(), &QTcpSocket::readyRead, this, &TrialSession::onReadyRead);
+    connect(m_connectTimer, &QTimer::timeout, this, &TrialSession::onConnectTimeout);
+    connect(m_idleTimer, &QTimer::timeout, this, &TrialSession::onIdleTimeout);
+}
+
+bool TrialSession::start(const QByteArray& command) {
+    if (m_running) {
+        return false;
+    }
+    m_running = true;
+    m_sent = false;
+    m_command = command;
+    m_unsent.clear();
+    m_ahead = 0;
+    m_parser.reset();
+
+    if (m_link->isUp()) {
+        sendCommand();
+    } else {
+        // The link reconnects on its own; give it the same grace period the
+        // blocking implementation had before declaring the robot unreachable.
+        m_link->open();
+        m_connectTimer->start();
+    }
+    return true;
+}
+
+bool TrialSession::queue(const QByteArray& command) {
+    if (!m_running) {
+        return false;
+    }
+    if (m_sent) {
+        m_link->socket()->write(command);
+        m_link->metrics().bytes_out.inc(static_cast<std::uint64_t>(command.size()));
+        ++m_ahead;
+    } else {
+        m_unsent.append(command);
+    }
+    return true;
+}
+
+void TrialSession::abort() {
+    if (!m_running) {
+        return;
+    }
+    stop();
+    // The robot script only gives up on a block when its client goes away.
+    m_link->reset();
+    emit aborted();
+}
+
+void TrialSession::onLinkUp() {
+    if (m_running && !m_sent) {
+        sendCommand();
+    }
+}
+
+void TrialSession::onLinkDown(const QString& reason) {
+    if (!m_running || !m_sent) {
+        return;
+    }
+    stop();
+    emit failed(reason);
+}
+
+void TrialSession::sendCommand() {
+    m_connectTimer->stop();
+    m_sent = true;
+    m_link->socket()->write(m_command);
+    m_link->metrics().bytes_out.inc(static_cast<std::uint64_t>(m_command.size()));
+    for (const QByteArray& command : m_unsent) {
+        m_link->socket()->write(command);
+        m_link->metrics().bytes_out.inc(static_cast<std::uint64_t>(command.size()));
+    }
+    m_ahead = m_unsent.size();
+    m_unsent.clear();
+    m_idleTimer->start();
+    emit started();
+}
+
+void TrialSession::onReadyRead() {
+    QTcpSocket* socket = m_link->socket();
+    char chunk[4096];
+    qint64 n;
+    while ((n = socket->read(chunk, sizeof(chunk))) > 0) {
+        m_link->metrics().bytes_in.inc(static_cast<std::uint64_t>(n));
+        if (!m_running || !m_sent) {
+            continue;
+        }
+        m_idleTimer->start();
+        // One read can end a block and already carry the next block's results.
+        std::size_t offset = 0;
+        while (m_running && offset < static_cast<std::size_t>(n)) {
+            offset += m_parser.feed(chunk + offset, static_cast<std::size_t>(n) - offset, [this](const TrialResult& result) {
+                emit trialFinished(result);
+            });
+            if (m_parser.failed()) {
+                // The rest of the stream cannot be trusted; reconnect as abort() does.
+                stop();
+                m_link->reset();
+                emit failed("Malformed result from robot");
+                return;
+            }
+            if (!m_parser.blockEnded()) {
+                break;
+            }
+            if (m_ahead > 0) {
+                --m_ahead;
+                m_parser.reset();
+            } else {
+                stop();
+            }
+            emit finished();
+        }
+    }
+}
+
+void TrialSession::onConnectTimeout() {
+    if (!m_running) {
+        return;
+    }
+    stop();
+    emit failed("Connection failed!");
+}
+
+void TrialSession::onIdleTimeout() {
+    if (!m_running) {
+        return;
+    }
+    stop();
+    emit failed("No response from robot");
+}
+
+void TrialSession::stop() {
+    m_running = false;
+    m_ahead = 0;
+    m_unsent.clear();
+    m_connectTimer->stop();
+    m_idleTimer->stop();
+}
@@ -0,0 +1,68 @@
+#ifndef TRIAL_SESSION_H
+#define TRIAL_SESSION_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QTimer>
+
+#include "trial_parser.h"
+
+class RobotLink;
+
+// Runs one experiment block against the robot without blocking the GUI thread.
+// The socket is driven entirely by signals; every "<trial>,<ms>,finished" record
+// is reported through trialFinished() as soon as it arrives, and the block ends
+// when the robot sends the "ff" terminator.
+//
+// Further blocks can be queued while one runs: their commands are written
+// straight away, the robot buffers them and starts each one on its own after
+// the previous "ff". finished() is emitted per block; the session stays
+// running while queued blocks remain.
+class TrialSession : public QObject {
+    Q_OBJECT
+
+public:
+    explicit TrialSession(RobotLink* link, QObject* parent = nullptr);
+
+    bool isRunning() const { return m_running; }
+    // Blocks queued behind the running one.
+    int queued() const { return m_ahead + m_unsent.size(); }
+
+public slots:
+    bool start(const QByteArray& command);
+    // Pipelines another block behind the running one; false when idle.
+    bool queue(const QByteArray& command);
+    void abort();
+
+signals:
+    void started();
+    void trialFinished(const TrialResult& result);
+    void finished();
+    void failed(const QString& reason);
+    void aborted();
+
+private slots:
+    void onLinkUp();
+    void onLinkDown(const QString& reason);
+    void onReadyRead();
+    void onConnectTimeout();
+    void onIdleTimeout();
+
+private:
+    void sendCommand();
+    void stop();
+
+    RobotLink* m_link;
+    QTimer* m_connectTimer;
+    QTimer* m_idleTimer;
+    QByteArray m_command;
+    QList<QByteArray> m_unsent; // queued before the first command went out
+    int m_ahead = 0;            // queued commands the robot already has
+    TrialStreamParser m_parser;
+    bool m_running = false;
+    bool m_sent = false;
+};
+
+#endif // TRIAL_SESSION_H
@@ -0,0 +1,31 @@
+#include "video_preview.h"
+
+#include <QPainter>
+
+VideoPreview::VideoPreview(QWidget* parent) : QWidget(parent) {
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(160, 120);
+}
+
+void VideoPreview::setFrame(const QImage& frame) {
+    m_frame = frame;
+    update();
+}
+
+void VideoPreview::clear() {
+    m_frame = QImage();
+    update();
+}
+
+// Scaled while painting, so no downscaled copy of the frame is made or kept.
+void VideoPreview::paintEvent(QPaintEvent*) {
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    if (m_frame.isNull()) {
+        return;
+    }
+    QSize target = m_frame.size().scaled(size(), Qt::KeepAspectRatio);
+    QRect area(QPoint(0, 0), target);
+    area.moveCenter(rect().center());
+    painter.drawImage(area, m_frame);
+}
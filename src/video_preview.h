@@ -0,0 +1,28 @@
+#ifndef VIDEO_PREVIEW_H
+#define VIDEO_PREVIEW_H
+
+#include <QImage>
+#include <QWidget>
+
+// Small live view of the camera while a block is recorded. The image it holds
+// wraps a FramePool slot directly; replacing it hands the slot back.
+class VideoPreview : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit VideoPreview(QWidget* parent = nullptr);
+
+    QSize sizeHint() const override { return QSize(320, 240); }
+
+public slots:
+    void setFrame(const QImage& frame);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    QImage m_frame;
+};
+
+#endif // VIDEO_PREVIEW_H
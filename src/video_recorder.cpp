@@ -0,0 +1,370 @@
+#include "video_recorder.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QMetaObject>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+
+#include "session_clock.h"
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+static constexpr int kIdleSleepMs = 2;
+
+VideoRecorder::VideoRecorder(const VideoRecorderConfig& config, QObject* parent)
+    : QObject(parent),
+      m_config(config),
+      m_pool(std::make_shared<FramePool>(config.width, config.height, 3, kPoolFrames)) {}
+
+VideoRecorder::~VideoRecorder() {
+    m_stop = true;
+    join();
+}
+
+bool VideoRecorder::start(const QString& label) {
+    if (m_recording) {
+        return false;
+    }
+    const QDateTime now = QDateTime::currentDateTime();
+    const QString dir = m_config.directory + "/" + now.toString("yyyy-MM-dd");
+    if (!QDir().mkpath(dir)) {
+        emit error("Cannot create " + dir);
+        return false;
+    }
+    QString name = label;
+    name.replace(' ', '_');
+    m_directory = dir + "/video_" + name + "_" + now.toString("HH-mm-ss");
+    if (!QDir().mkpath(m_directory)) {
+        emit error("Cannot create " + m_directory);
+        return false;
+    }
+    m_captureError.clear();
+    m_encodeError.clear();
+    m_stop = false;
+    m_captureDone = false;
+    m_frames = 0;
+    m_dropped = 0;
+    m_startNs = sessionClockNs();
+    m_endNs = m_startNs;
+    m_recording = true;
+
+    m_encodeThread = std::thread(&VideoRecorder::encodeLoop, this);
+    m_captureThread = std::thread(&VideoRecorder::captureLoop, this);
+    emit started(m_directory);
+    return true;
+}
+
+void VideoRecorder::stop() {
+    m_stop = true;
+}
+
+void VideoRecorder::join() {
+    if (m_captureThread.joinable()) {
+        m_captureThread.join();
+    }
+    if (m_encodeThread.joinable()) {
+        m_encodeThread.join();
+    }
+}
+
+void VideoRecorder::captureLoop() {
+    cv::VideoCapture capture(m_config.url.toStdString());
+    if (!capture.isOpened()) {
+        m_captureError = "Cannot open camera " + m_config.url;
+        m_captureDone = true;
+        return;
+    }
+    const std::int64_t limitNs = static_cast<std::int64_t>(m_config.maxSeconds) * 1000000000;
+    const std::int64_t previewIntervalNs = static_cast<std::int64_t>(m_config.previewIntervalMs) * 1000000;
+    std::int64_t lastPreviewNs = 0;
+    // Only used when the camera does not deliver the configured size.
+    cv::Mat scratch;
+    bool resizing = false;
+
+    while (!m_stop) {
+        if (!capture.grab()) {
+            m_captureError = "Can't receive frame (stream end?)";
+            break;
+        }
+        FrameRef ref;
+        ref.timestampNs = sessionClockNs();
+        if (ref.timestampNs - m_startNs >= limitNs) {
+            break;
+        }
+        ref.slot = m_pool->acquire();
+        if (ref.slot < 0) {
+            ++m_dropped;
+            if (m_droppedCounter) {
+                m_droppedCounter->inc();
+            }
+            continue;
+        }
+
+        cv::Mat view(m_pool->height(), m_pool->width(), CV_8UC3, m_pool->data(ref.slot), m_pool->stride());
+        cv::Mat decoded = resizing ? scratch : view;
+        if (!capture.retrieve(decoded)) {
+            m_pool->release(ref.slot);
+            continue;
+        }
+        if (decoded.data != view.data) {
+            // retrieve() reallocated, so the stream is not at the pool size.
+            resizing = true;
+            scratch = decoded;
+            cv::resize(decoded, view, view.size());
+        }
+
+        if (ref.timestampNs - lastPreviewNs >= previewIntervalNs && m_pool->freeCount() > kPreviewReserve) {
+            m_pool->retain(ref.slot);
+            FrameRef preview = ref;
+            if (m_previewQueue.push(std::move(preview))) {
+                lastPreviewNs = ref.timestampNs;
+                if (!m_previewPending.exchange(true)) {
+                    QMetaObject::invokeMethod(this, "onPreviewReady", Qt::QueuedConnection);
+                }
+            } else {
+                m_pool->release(ref.slot);
+            }
+        }
+        const int slot = ref.slot;
+        if (!m_queue.push(std::move(ref))) {
+            m_pool->release(slot);
+            ++m_dropped;
+            if (m_droppedCounter) {
+                m_droppedCounter->inc();
+            }
+        }
+    }
+    m_captureDone = true;
+}
+
+void VideoRecorder::markTrial(int trial, qint64 startNs, qint64 endNs) {
+    if (!m_recording) {
+        return;
+    }
+    TrialMark mark{trial, startNs, endNs};
+    if (!m_marks.push(std::move(mark))) {
+        qDebug() << "Trial mark queue full, trial" << trial << "not indexed";
+    }
+}
+
+static std::FILE* openIndex(const QString& path, const char* header) {
+    std::FILE* file = std::fopen(path.toLocal8Bit().constData(), "w");
+    if (file) {
+        std::fputs(header, file);
+        std::fflush(file);
+    }
+    return file;
+}
+
+// Everything written so far reaches the disk: a crash loses at most the
+// segment that is currently open.
+static void syncIndex(std::FILE* file) {
+    if (!file) {
+        return;
+    }
+    std::fflush(file);
+#ifdef Q_OS_UNIX
+    ::fsync(::fileno(file));
+#endif
+}
+
+// The codec is settled on the first segment and reused for the rest.
+bool VideoRecorder::openSegment(const cv::Size& size) {
+    ++m_segment;
+    const QString base = m_directory + QString("/seg_%1").arg(m_segment, 5, 10, QChar('0'));
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 5)
+    if (m_config.hardwareEncode && m_segmentExtension != ".avi") {
+        const std::vector<int> params = {cv::VIDEOWRITER_PROP_HW_ACCELERATION, cv::VIDEO_ACCELERATION_ANY};
+        if (m_writer.open((base + ".mp4").toStdString(), cv::CAP_FFMPEG, cv::VideoWriter::fourcc('a', 'v', 'c', '1'),
+                          m_config.fps, size, params)) {
+            m_segmentExtension = ".mp4";
+            return true;
+        }
+        if (m_segmentExtension.isEmpty()) {
+            qDebug() << "No hardware encoder available, falling back to XVID";
+        }
+    }
+#endif
+    if (m_writer.open((base + ".avi").toStdString(), cv::VideoWriter::fourcc('X', 'V', 'I', 'D'), m_config.fps, size)) {
+        m_segmentExtension = ".avi";
+        return true;
+    }
+    m_encodeError = "Cannot open video writer for " + base;
+    return false;
+}
+
+void VideoRecorder::closeSegment(std::int64_t frames) {
+    if (!m_writer.isOpened()) {
+        return;
+    }
+    m_writer.release();
+    const std::int64_t first = static_cast<std::int64_t>(m_segment) * m_framesPerSegment;
+    if (m_segmentsIndex && frames > first) {
+        std::fprintf(m_segmentsIndex, "%d,seg_%05d%s,%lld,%lld,%lld,%lld\n", m_segment, m_segment,
+                     m_segmentExtension.toLatin1().constData(), static_cast<long long>(first),
+                     static_cast<long long>(frames - first), static_cast<long long>(m_frameNs[first]),
+                     static_cast<long long>(m_frameNs[frames - 1]));
+    }
+    syncIndex(m_timestamps);
+    syncIndex(m_segmentsIndex);
+}
+
+// A trial is resolved once a frame past its end has been written (or, when
+// final, with whatever was recorded). Its first and last frames are the
+// frames stamped inside [startNs, endNs].
+void VideoRecorder::resolveTrials(bool final) {
+    TrialMark mark;
+    while (m_marks.pop(mark)) {
+        m_pendingMarks.push_back(mark);
+    }
+    size_t done = 0;
+    for (; done < m_pendingMarks.size(); ++done) {
+        const TrialMark& t = m_pendingMarks[done];
+        if (!final && (m_frameNs.empty() || m_frameNs.back() < t.endNs)) {
+            break;
+        }
+        const auto begin = std::lower_bound(m_frameNs.begin(), m_frameNs.end(), t.startNs);
+        const auto end = std::upper_bound(m_frameNs.begin(), m_frameNs.end(), t.endNs);
+        long long first = -1;
+        long long last = -1;
+        if (begin < end) {
+            first = begin - m_frameNs.begin();
+            last = (end - m_frameNs.begin()) - 1;
+        }
+        if (m_trialsIndex) {
+            const long long perSegment = m_framesPerSegment;
+            std::fprintf(m_trialsIndex, "%d,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld\n", t.trial,
+                         static_cast<long long>(t.startNs), static_cast<long long>(t.endNs), first, last,
+                         first < 0 ? -1 : first / perSegment, first < 0 ? -1 : first % perSegment,
+                         last < 0 ? -1 : last / perSegment, last < 0 ? -1 : last % perSegment);
+            syncIndex(m_trialsIndex);
+        }
+    }
+    m_pendingMarks.erase(m_pendingMarks.begin(), m_pendingMarks.begin() + done);
+}
+
+void VideoRecorder::encodeLoop() {
+    const cv::Size size(m_pool->width(), m_pool->height());
+    bool writerFailed = false;
+    std::int64_t written = 0;
+    FrameRef frame;
+
+    m_segment = -1;
+    m_segmentExtension.clear();
+    m_framesPerSegment = std::max(1, static_cast<int>(m_config.fps * m_config.segmentSeconds + 0.5));
+    m_frameNs.clear();
+    m_frameNs.reserve(static_cast<size_t>(m_config.fps * m_config.maxSeconds * 1.25));
+    m_pendingMarks.clear();
+    m_timestamps = openIndex(m_directory + "/frames.csv", "frame,monotonic_ns\n");
+    m_segmentsIndex = openIndex(m_directory + "/segments.csv", "segment,file,first_frame,frame_count,first_ns,last_ns\n");
+    m_trialsIndex = openIndex(m_directory + "/trials.csv",
+                              "trial,start_ns,end_ns,first_frame,last_frame,first_segment,first_offset,last_segment,last_offset\n");
+
+    for (;;) {
+        if (!m_queue.pop(frame)) {
+            // The capture side sets m_captureDone after its last push.
+            if (m_captureDone && m_queue.size() == 0) {
+                break;
+            }
+            resolveTrials(false);
+            std::this_thread::sleep_for(std::chrono::milliseconds(kIdleSleepMs));
+            continue;
+        }
+        if (writerFailed) {
+            m_pool->release(frame.slot);
+            continue;
+        }
+        if (written % m_framesPerSegment == 0) {
+            closeSegment(written);
+            if (!openSegment(size)) {
+                writerFailed = true;
+                m_stop = true;
+                m_pool->release(frame.slot);
+                continue;
+            }
+        }
+        m_writer.write(cv::Mat(size, CV_8UC3, m_pool->data(frame.slot), m_pool->stride()));
+        m_pool->release(frame.slot);
+        if (m_timestamps) {
+            std::fprintf(m_timestamps, "%lld,%lld\n", static_cast<long long>(written),
+                         static_cast<long long>(frame.timestampNs));
+        }
+        m_frameNs.push_back(frame.timestampNs);
+        m_endNs = frame.timestampNs;
+        ++written;
+        m_frames = written;
+        if (m_framesCounter) {
+            m_framesCounter->inc();
+        }
+    }
+    closeSegment(written);
+    resolveTrials(true);
+    for (std::FILE** file : {&m_timestamps, &m_segmentsIndex, &m_trialsIndex}) {
+        if (*file) {
+            std::fclose(*file);
+            *file = nullptr;
+        }
+    }
+    QMetaObject::invokeMethod(this, "onThreadsFinished", Qt::QueuedConnection);
+}
+
+void VideoRecorder::onPreviewReady() {
+    m_previewPending = false;
+    FrameRef ref;
+    FrameRef latest;
+    while (m_previewQueue.pop(ref)) {
+        if (latest.slot >= 0) {
+            m_pool->release(latest.slot);
+        }
+        latest = ref;
+    }
+    if (latest.slot < 0) {
+        return;
+    }
+
+    struct Hold {
+        std::shared_ptr<FramePool> pool;
+        int slot;
+    };
+    // The pool is shared with the image so a preview outliving the recorder is safe.
+    Hold* hold = new Hold{m_pool, latest.slot};
+    QImage image(
+        m_pool->data(latest.slot), m_pool->width(), m_pool->height(), static_cast<int>(m_pool->stride()),
+        QImage::Format_BGR888,
+        [](void* info) {
+            Hold* h = static_cast<Hold*>(info);
+            h->pool->release(h->slot);
+            delete h;
+        },
+        hold);
+    emit previewFrame(image);
+}
+
+void VideoRecorder::onThreadsFinished() {
+    join();
+    m_recording = false;
+    // Preview frames still queued after the last capture.
+    FrameRef ref;
+    while (m_previewQueue.pop(ref)) {
+        m_pool->release(ref.slot);
+    }
+    for (const QString& reason : {m_captureError, m_encodeError}) {
+        if (!reason.isEmpty()) {
+            emit error(reason);
+        }
+    }
+
+    const double seconds = (m_endNs - m_startNs) / 1e9;
+    const bool kept = m_frames > 0 && seconds >= m_config.minSeconds;
+    if (!kept) {
+        qDebug().noquote() << QString("Recording was too short (%1 seconds). Deleting: %2").arg(seconds, 0, 'f', 2).arg(m_directory);
+        QDir(m_directory).removeRecursively();
+    }
+    emit stopped(m_directory, kept, m_frames, m_dropped);
+}
@@ -0,0 +1,135 @@
+#ifndef VIDEO_RECORDER_H
+#define VIDEO_RECORDER_H
+
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "../common/metrics.h"
+#include "frame_pool.h"
+#include "spsc_queue.h"
+
+struct VideoRecorderConfig {
+    QString url;
+    QString directory = "video";
+    double fps = 60.0;
+    int width = 640;
+    int height = 480;
+    int maxSeconds = 300;  // recording is cut off after this long
+    int minSeconds = 100;  // shorter recordings are deleted on stop
+    bool hardwareEncode = true;
+    int previewIntervalMs = 66;  // ~15 fps live view
+    int segmentSeconds = 10;
+};
+
+// Records the IP camera for one block. A capture thread only grabs frames and
+// stamps them with sessionClockNs() the moment grab() returns; an encoder
+// thread drains them through a lock-free queue, so a slow encode never stalls
+// the camera.
+//
+// A recording is a directory of short, independently decodable segments:
+//   seg_NNNNN.mp4|avi  segmentSeconds worth of frames each
+//   frames.csv         frame -> monotonic ns (the trial rows' timebase)
+//   segments.csv       segment -> file, first frame, frame count, time span
+//   trials.csv         trial -> first/last frame and segment/offset of each
+// Index lines are flushed and synced as each segment closes, so after a crash
+// everything but the open segment is still readable, and a trial is found by
+// opening its segment and seeking to an offset.
+class VideoRecorder : public QObject {
+    Q_OBJECT
+
+public:
+    explicit VideoRecorder(const VideoRecorderConfig& config, QObject* parent = nullptr);
+    ~VideoRecorder() override;
+
+    bool isRecording() const { return m_recording; }
+    // Running totals across recordings, bumped from the worker threads; set
+    // before the first start().
+    void setCounters(metrics::Counter* frames, metrics::Counter* dropped) {
+        m_framesCounter = frames;
+        m_droppedCounter = dropped;
+    }
+
+public slots:
+    bool start(const QString& label);
+    // Indexes a trial's span (sessionClockNs()) against the recorded frames.
+    void markTrial(int trial, qint64 startNs, qint64 endNs);
+    // Asks both threads to finish; stopped() follows once the file is closed.
+    void stop();
+
+signals:
+    void started(const QString& fileName);
+    // Wraps a pool slot without copying; the slot is released with the image.
+    void previewFrame(const QImage& frame);
+    void stopped(const QString& fileName, bool kept, qint64 frames, qint64 dropped);
+    void error(const QString& reason);
+
+private slots:
+    void onThreadsFinished();
+    void onPreviewReady();
+
+private:
+    static constexpr std::size_t kPoolFrames = 32;
+    static constexpr std::size_t kPreviewReserve = 8;
+
+    struct FrameRef {
+        int slot = -1;
+        std::int64_t timestampNs = 0;
+    };
+    struct TrialMark {
+        int trial = 0;
+        std::int64_t startNs = 0;
+        std::int64_t endNs = 0;
+    };
+
+    void captureLoop();
+    void encodeLoop();
+    bool openSegment(const cv::Size& size);
+    void closeSegment(std::int64_t frames);
+    void resolveTrials(bool final);
+    void join();
+
+    VideoRecorderConfig m_config;
+    std::shared_ptr<FramePool> m_pool;
+    SpscQueue<FrameRef, kPoolFrames> m_queue;
+    SpscQueue<FrameRef, 2> m_previewQueue;
+    std::atomic<bool> m_previewPending{false};
+    SpscQueue<TrialMark, 32> m_marks;
+    std::thread m_captureThread;
+    std::thread m_encodeThread;
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_captureDone{false};
+    bool m_recording = false;
+
+    // Owned by the worker threads while recording, read on the GUI thread
+    // only after join().
+    QString m_directory;
+    QString m_captureError;
+    QString m_encodeError;
+    cv::VideoWriter m_writer;
+    std::FILE* m_timestamps = nullptr;
+    std::FILE* m_segmentsIndex = nullptr;
+    std::FILE* m_trialsIndex = nullptr;
+    QString m_segmentExtension;
+    int m_segment = -1;
+    int m_framesPerSegment = 1;
+    std::vector<std::int64_t> m_frameNs;
+    std::vector<TrialMark> m_pendingMarks;
+    std::int64_t m_startNs = 0;
+    std::int64_t m_endNs = 0;
+    std::atomic<std::int64_t> m_frames{0};
+    std::atomic<std::int64_t> m_dropped{0};
+    metrics::Counter* m_framesCounter = nullptr;
+    metrics::Counter* m_droppedCounter = nullptr;
+};
+
+#endif // VIDEO_RECORDER_H
@@ -0,0 +1,102 @@
+// Python bindings: `import join_engine`. Columns are handed back as NumPy
+// arrays that own the C++ vectors (no copy), so
+//     pd.DataFrame(store.join())
+// is the whole conversion.
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "trial_join.h"
+
+namespace py = pybind11;
+using namespace trial_join;
+
+template <typename T>
+static py::array_t<T> to_numpy(std::vector<T>&& column) {
+    auto* owned = new std::vector<T>(std::move(column));
+    py::capsule release(owned, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    return py::array_t<T>(owned->size(), owned->data(), release);
+}
+
+static py::dict joined_to_dict(JoinedColumns&& j) {
+    py::dict out;
+    py::list labels;
+    for (const std::string& l : j.labels) labels.append(l);
+    out["Participant"] = to_numpy(std::move(j.participant));
+    // Label ids index into the sorted label list; expose the strings directly.
+    py::array_t<int32_t> ids = to_numpy(std::move(j.block));
+    out["Block"] = py::module_::import("numpy").attr("array")(labels, "object")[ids];
+    out["Trial"] = to_numpy(std::move(j.trial));
+    out["Operation time"] = to_numpy(std::move(j.operation_s));
+    out["Red"] = to_numpy(std::move(j.red));
+    out["Direct"] = to_numpy(std::move(j.direct));
+    out["True"] = to_numpy(std::move(j.truth));
+    out["Frames"] = to_numpy(std::move(j.frames));
+    for (int e = 0; e < kEmotionCount; ++e) out[kEmotionNames[e]] = to_numpy(std::move(j.share[e]));
+    return out;
+}
+
+PYBIND11_MODULE(join_engine, m) {
+    m.doc() = "Columnar cohort join of trial results and per-frame emotion timelines";
+    m.attr("EMOTIONS") = py::make_tuple("Angry", "Disgust", "Fear", "Happy", "Neutral", "Sad", "Surprise");
+
+    py::class_<CohortStore>(m, "CohortStore")
+        .def(py::init<>())
+        .def(
+            "add_results_csv",
+            [](CohortStore& s, const std::string& path, int32_t participant) {
+                const int n = s.add_results_csv(path, participant);
+                if (n < 0) throw std::runtime_error("cannot open " + path);
+                return n;
+            },
+            py::arg("path"), py::arg("participant"),
+            "Reads a data_<date>.csv written by the GUI; returns the number of blocks.")
+        .def(
+            "add_face_tool",
+            [](CohortStore& s, const std::string& dir, int32_t participant, const std::string& label) {
+                std::string error;
+                if (!s.add_face_tool(dir, participant, label, &error)) throw std::runtime_error(error);
+            },
+            py::arg("dir"), py::arg("participant"), py::arg("block"),
+            "Reads a face_tool --out directory as the emotion timeline of one block.")
+        .def(
+            "add_timeline",
+            [](CohortStore& s, int32_t participant, const std::string& label,
+               py::array_t<int64_t, py::array::c_style | py::array::forcecast> t,
+               py::array_t<float, py::array::c_style | py::array::forcecast> emotions, bool monotonic) {
+                if (emotions.ndim() != 2 || emotions.shape(1) != kEmotionCount || emotions.shape(0) != t.size()) {
+                    throw std::invalid_argument("emotions must be an (N, 7) array matching t");
+                }
+                Timeline timeline;
+                timeline.participant = participant;
+                timeline.label = label;
+                timeline.monotonic = monotonic;
+                timeline.t.assign(t.data(), t.data() + t.size());
+                auto e = emotions.unchecked<2>();
+                for (int k = 0; k < kEmotionCount; ++k) {
+                    timeline.emotion[k].resize(e.shape(0));
+                    for (py::ssize_t i = 0; i < e.shape(0); ++i) timeline.emotion[k][i] = e(i, k);
+                }
+                s.add_timeline(std::move(timeline));
+            },
+            py::arg("participant"), py::arg("block"), py::arg("t"), py::arg("emotions"), py::arg("monotonic") = false,
+            "Adds a timeline: t is frame numbers (or monotonic ns), emotions an (N, 7) array, NaN rows = no face.")
+        .def(
+            "join",
+            [](const CohortStore& s, double fps, unsigned threads, bool only_finished) {
+                JoinedColumns j;
+                {
+                    py::gil_scoped_release unlocked;
+                    j = s.join(fps, threads, only_finished);
+                }
+                return joined_to_dict(std::move(j));
+            },
+            py::arg("fps") = 15.0, py::arg("threads") = 0, py::arg("only_finished") = true,
+            "Joins every block with its timeline; returns a dict of columns.")
+        .def_property_readonly("block_count", [](const CohortStore& s) { return s.blocks().size(); })
+        .def_property_readonly("timeline_count", [](const CohortStore& s) { return s.timelines().size(); });
+}
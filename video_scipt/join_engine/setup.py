@@ -0,0 +1,17 @@
+# Builds the join_engine extension: pip install ./join_engine
+from pybind11.setup_helpers import Pybind11Extension, build_ext
+from setuptools import setup
+
+setup(
+    name="join_engine",
+    version="0.1.0",
+    ext_modules=[
+        Pybind11Extension(
+            "join_engine",
+            ["bindings.cpp", "trial_join.cpp"],
+            cxx_std=17,
+            extra_compile_args=["-O3"],
+        )
+    ],
+    cmdclass={"build_ext": build_ext},
+)
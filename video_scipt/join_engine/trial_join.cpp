@@ -0,0 +1,303 @@
+#include "trial_join.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+namespace trial_join {
+
+static void split(const std::string& line, std::vector<std::string>& fields) {
+    fields.clear();
+    size_t begin = 0;
+    for (;;) {
+        const size_t comma = line.find(',', begin);
+        std::string field = line.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin);
+        const size_t first = field.find_first_not_of(" \r");
+        const size_t last = field.find_last_not_of(" \r");
+        fields.push_back(first == std::string::npos ? std::string() : field.substr(first, last - first + 1));
+        if (comma == std::string::npos) break;
+        begin = comma + 1;
+    }
+}
+
+static bool starts_with(const std::string& s, const char* prefix) {
+    return s.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+int CohortStore::add_results_csv(const std::string& path, int32_t participant) {
+    std::ifstream in(path);
+    if (!in) return -1;
+
+    std::string line;
+    std::vector<std::string> fields;
+    Block block;
+    bool open = false;
+    int added = 0;
+    auto close_block = [&]() {
+        if (open) {
+            blocks_.push_back(std::move(block));
+            ++added;
+        }
+        block = Block();
+        open = false;
+    };
+
+    while (std::getline(in, line)) {
+        if (starts_with(line, "Experiment block start time")) {
+            close_block(); // a block without an end row: the GUI was killed mid-block
+            block.participant = participant;
+            open = true;
+            split(line, fields);
+            for (size_t i = 0; i + 1 < fields.size(); ++i) {
+                if (fields[i] == "Monotonic ns") block.start_ns = std::atoll(fields[i + 1].c_str());
+            }
+        } else if (starts_with(line, "Experiment ")) {
+            // "Experiment <label> <outcome> using <seconds> seconds"
+            const size_t using_at = line.rfind(" using ");
+            const size_t outcome_at = line.rfind(' ', using_at == std::string::npos ? std::string::npos : using_at - 1);
+            if (open && using_at != std::string::npos && outcome_at != std::string::npos && outcome_at > 11) {
+                block.label = line.substr(11, outcome_at - 11);
+                block.outcome = line.substr(outcome_at + 1, using_at - outcome_at - 1);
+            }
+            close_block();
+        } else if (open && !starts_with(line, "Trial no.")) {
+            split(line, fields);
+            if (fields.size() < 5 || fields[0].empty()) continue;
+            char* end = nullptr;
+            const long trial = std::strtol(fields[0].c_str(), &end, 10);
+            if (*end != '\0') continue;
+            TrialColumns& t = block.trials;
+            t.trial.push_back(static_cast<int32_t>(trial));
+            t.operation_s.push_back(std::atof(fields[1].c_str()));
+            t.red.push_back(fields[2] == "Red");
+            t.direct.push_back(fields[3] == "direct");
+            t.truth.push_back(fields[4] == "true" || fields[4] == "True");
+            t.finished_ns.push_back(fields.size() > 5 && !fields[5].empty() ? std::atoll(fields[5].c_str()) : -1);
+        }
+    }
+    close_block();
+    return added;
+}
+
+// Minimal reader for the 1-D .npy columns face_tool writes.
+static bool read_npy(const std::string& path, std::vector<double>& out, std::string* error) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    unsigned char preamble[10];
+    bool ok = std::fread(preamble, 1, sizeof(preamble), f) == sizeof(preamble) &&
+              std::memcmp(preamble, "\x93NUMPY", 6) == 0 && preamble[6] == 1;
+    std::string header;
+    if (ok) {
+        header.resize(preamble[8] | (preamble[9] << 8));
+        ok = std::fread(&header[0], 1, header.size(), f) == header.size();
+    }
+    size_t count = 0;
+    std::string descr;
+    if (ok) {
+        const size_t d = header.find("'descr': '");
+        const size_t s = header.find("'shape': (");
+        ok = d != std::string::npos && s != std::string::npos;
+        if (ok) {
+            descr = header.substr(d + 10, 3);
+            count = std::strtoull(header.c_str() + s + 10, nullptr, 10);
+        }
+    }
+    if (ok) {
+        out.resize(count);
+        auto read_as = [&](auto sample) {
+            using T = decltype(sample);
+            std::vector<T> raw(count);
+            if (std::fread(raw.data(), sizeof(T), count, f) != count) return false;
+            std::transform(raw.begin(), raw.end(), out.begin(), [](T v) { return static_cast<double>(v); });
+            return true;
+        };
+        if (descr == "<f4") ok = read_as(float());
+        else if (descr == "<f8") ok = read_as(double());
+        else if (descr == "<i8") ok = read_as(int64_t());
+        else if (descr == "<i4") ok = read_as(int32_t());
+        else if (descr == "|u1") ok = read_as(uint8_t());
+        else ok = false;
+    }
+    std::fclose(f);
+    if (!ok && error) *error = "unsupported or truncated " + path;
+    return ok;
+}
+
+static bool file_exists(const std::string& path) {
+    std::ifstream f(path);
+    return f.good();
+}
+
+bool CohortStore::add_face_tool(const std::string& dir, int32_t participant, const std::string& label,
+                                std::string* error) {
+    static constexpr const char* kFiles[kEmotionCount] = {"angry", "disgust", "fear", "happy", "neutral", "sad", "surprise"};
+    Timeline timeline;
+    timeline.participant = participant;
+    timeline.label = label;
+
+    std::vector<double> column;
+    timeline.monotonic = file_exists(dir + "/monotonic_ns.npy");
+    if (!read_npy(dir + (timeline.monotonic ? "/monotonic_ns.npy" : "/frame.npy"), column, error)) return false;
+    timeline.t.assign(column.begin(), column.end());
+
+    std::vector<double> state;
+    const bool has_state = read_npy(dir + "/state.npy", state, nullptr) && state.size() == column.size();
+    for (int e = 0; e < kEmotionCount; ++e) {
+        if (!read_npy(dir + "/" + kFiles[e] + ".npy", column, error)) return false;
+        if (column.size() != timeline.t.size()) {
+            if (error) *error = std::string(kFiles[e]) + ".npy length differs from the frame column";
+            return false;
+        }
+        std::vector<float>& out = timeline.emotion[e];
+        out.resize(column.size());
+        for (size_t i = 0; i < column.size(); ++i) {
+            // state 0: no face, the same as DeepFace's empty row.
+            out[i] = (has_state && state[i] == 0) ? NAN : static_cast<float>(column[i]);
+        }
+    }
+    add_timeline(std::move(timeline));
+    return true;
+}
+
+void CohortStore::add_timeline(Timeline timeline) {
+    timelines_.push_back(std::move(timeline));
+}
+
+// Percent of frames per dominant emotion over rows [begin, end).
+static void tally(const Timeline& timeline, size_t begin, size_t end, JoinedColumns& out) {
+    std::array<int, kEmotionCount> counts{};
+    int valid = 0;
+    end = std::min(end, timeline.t.size());
+    for (size_t i = begin; i < end; ++i) {
+        int best = -1;
+        float best_score = 0.f;
+        for (int e = 0; e < kEmotionCount; ++e) {
+            const float v = timeline.emotion[e][i];
+            if (std::isnan(v)) continue;
+            if (best < 0 || v > best_score) {
+                best = e;
+                best_score = v;
+            }
+        }
+        if (best >= 0) {
+            ++counts[best];
+            ++valid;
+        }
+    }
+    out.frames.push_back(valid);
+    for (int e = 0; e < kEmotionCount; ++e) {
+        out.share[e].push_back(valid ? 100.0 * counts[e] / valid : 0.0);
+    }
+}
+
+void join_block(const Block& block, const Timeline& timeline, double fps, int32_t label, JoinedColumns& out) {
+    const TrialColumns& trials = block.trials;
+    const size_t n = trials.trial.size();
+    const bool monotonic = timeline.monotonic &&
+                           std::all_of(trials.finished_ns.begin(), trials.finished_ns.end(), [](int64_t v) { return v >= 0; });
+
+    size_t lo = 0;
+    size_t hi = 0;
+    int64_t cumulative = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out.participant.push_back(block.participant);
+        out.block.push_back(label);
+        out.trial.push_back(trials.trial[i]);
+        out.operation_s.push_back(trials.operation_s[i]);
+        out.red.push_back(trials.red[i]);
+        out.direct.push_back(trials.direct[i]);
+        out.truth.push_back(trials.truth[i]);
+
+        size_t begin, end;
+        if (monotonic) {
+            // Trials arrive in order, so both edges only move forward; step
+            // back only for the rare window that starts before the previous one.
+            const int64_t stop = trials.finished_ns[i];
+            const int64_t start = stop - static_cast<int64_t>(trials.operation_s[i] * 1e9);
+            if (lo > 0 && timeline.t[lo - 1] >= start) {
+                lo = std::lower_bound(timeline.t.begin(), timeline.t.begin() + lo, start) - timeline.t.begin();
+            }
+            while (lo < timeline.t.size() && timeline.t[lo] < start) ++lo;
+            hi = std::max(hi, lo);
+            while (hi < timeline.t.size() && timeline.t[hi] < stop) ++hi;
+            begin = lo;
+            end = hi;
+        } else {
+            // trials_analysis.py: int(operation * fps) frames per trial, back to back.
+            const int64_t frames = static_cast<int64_t>(trials.operation_s[i] * fps);
+            begin = static_cast<size_t>(cumulative);
+            cumulative += frames;
+            end = static_cast<size_t>(cumulative);
+        }
+        tally(timeline, begin, end, out);
+    }
+}
+
+static void append(JoinedColumns& dst, JoinedColumns& src) {
+    auto move_into = [](auto& d, auto& s) { d.insert(d.end(), s.begin(), s.end()); };
+    move_into(dst.participant, src.participant);
+    move_into(dst.block, src.block);
+    move_into(dst.trial, src.trial);
+    move_into(dst.operation_s, src.operation_s);
+    move_into(dst.red, src.red);
+    move_into(dst.direct, src.direct);
+    move_into(dst.truth, src.truth);
+    move_into(dst.frames, src.frames);
+    for (int e = 0; e < kEmotionCount; ++e) move_into(dst.share[e], src.share[e]);
+}
+
+JoinedColumns CohortStore::join(double fps, unsigned threads, bool only_finished) const {
+    JoinedColumns result;
+
+    // Stable label ids, in sorted order so the output does not depend on load order.
+    std::map<std::string, int32_t> label_ids;
+    for (const Block& b : blocks_) label_ids.emplace(b.label, 0);
+    for (auto& [name, id] : label_ids) {
+        id = static_cast<int32_t>(result.labels.size());
+        result.labels.push_back(name);
+    }
+
+    std::unordered_map<std::string, const Timeline*> timeline_of;
+    for (const Timeline& t : timelines_) timeline_of[std::to_string(t.participant) + '\n' + t.label] = &t;
+
+    std::map<int32_t, std::vector<const Block*>> by_participant;
+    for (const Block& b : blocks_) {
+        if (only_finished && b.outcome != "finished") continue;
+        by_participant[b.participant].push_back(&b);
+    }
+    std::vector<std::vector<const Block*>*> groups;
+    for (auto& [participant, list] : by_participant) groups.push_back(&list);
+
+    std::vector<JoinedColumns> parts(groups.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t g = next++; g < groups.size(); g = next++) {
+            for (const Block* b : *groups[g]) {
+                auto it = timeline_of.find(std::to_string(b->participant) + '\n' + b->label);
+                if (it == timeline_of.end()) continue;
+                join_block(*b, *it->second, fps, label_ids.at(b->label), parts[g]);
+            }
+        }
+    };
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, std::max<size_t>(groups.size(), 1));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool) t.join();
+
+    for (JoinedColumns& part : parts) append(result, part);
+    return result;
+}
+
+} // namespace trial_join
@@ -0,0 +1,96 @@
+#ifndef TRIAL_JOIN_H
+#define TRIAL_JOIN_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Columnar trial/emotion join for a whole cohort.
+//
+// Trials come from the data_<date>.csv files the GUI writes (one row per
+// trial, grouped into blocks by the "Experiment block start time" and
+// "Experiment <label> <outcome>" rows). Emotion timelines come from face_tool
+// output directories or are handed in as arrays. Each trial gets the share of
+// frames per dominant emotion inside its time window, the number
+// trials_analysis.py computes with pandas.
+namespace trial_join {
+
+static constexpr int kEmotionCount = 7;
+static constexpr const char* kEmotionNames[kEmotionCount] = {
+    "Angry", "Disgust", "Fear", "Happy", "Neutral", "Sad", "Surprise"};
+
+// Trials of one block, one entry per column.
+struct TrialColumns {
+    std::vector<int32_t> trial;
+    std::vector<double> operation_s;
+    std::vector<uint8_t> red;       // 0 green, 1 red
+    std::vector<uint8_t> direct;    // 1 direct, 0 indirect
+    std::vector<uint8_t> truth;     // T/F column: 1 true trajectory
+    std::vector<int64_t> finished_ns; // -1 when the file predates the column
+};
+
+struct Block {
+    int32_t participant = 0;
+    std::string label;     // "Baseline", "Practice", "Block 1", ...
+    std::string outcome;   // finished / failed / aborted (empty if the file was cut off)
+    int64_t start_ns = -1;
+    TrialColumns trials;
+};
+
+// Per-frame emotion scores of one participant and block. Times are either
+// monotonic ns (face_tool on a GUI recording) or frame numbers at a fixed fps.
+struct Timeline {
+    int32_t participant = 0;
+    std::string label;
+    bool monotonic = false;
+    std::vector<int64_t> t; // ascending
+    std::array<std::vector<float>, kEmotionCount> emotion; // NaN: no face in that frame
+};
+
+// Joined table: one entry per trial, in participant, block, trial order.
+struct JoinedColumns {
+    std::vector<int32_t> participant;
+    std::vector<int32_t> block;        // index into labels
+    std::vector<int32_t> trial;
+    std::vector<double> operation_s;
+    std::vector<uint8_t> red;
+    std::vector<uint8_t> direct;
+    std::vector<uint8_t> truth;
+    std::vector<int32_t> frames;       // frames with a face inside the window
+    std::array<std::vector<double>, kEmotionCount> share; // percent of those frames
+    std::vector<std::string> labels;
+
+    size_t size() const { return trial.size(); }
+};
+
+class CohortStore {
+public:
+    // Returns the number of blocks read, or -1 when the file cannot be opened.
+    int add_results_csv(const std::string& path, int32_t participant);
+    // Reads a face_tool --out directory (monotonic_ns.npy or frame.npy plus
+    // the emotion columns).
+    bool add_face_tool(const std::string& dir, int32_t participant, const std::string& label, std::string* error);
+    void add_timeline(Timeline timeline);
+
+    const std::vector<Block>& blocks() const { return blocks_; }
+    const std::vector<Timeline>& timelines() const { return timelines_; }
+
+    // Joins every block with its timeline (same participant and label),
+    // participants in parallel. Windows are [finished - operation, finished)
+    // when both sides carry monotonic time, else trials_analysis.py's
+    // cumulative frame windows at fps. only_finished drops failed and aborted
+    // blocks.
+    JoinedColumns join(double fps, unsigned threads, bool only_finished) const;
+
+private:
+    std::vector<Block> blocks_;
+    std::vector<Timeline> timelines_;
+};
+
+// Sorted-interval merge of one block against one timeline; appends to out.
+void join_block(const Block& block, const Timeline& timeline, double fps, int32_t label, JoinedColumns& out);
+
+} // namespace trial_join
+
+#endif // TRIAL_JOIN_H
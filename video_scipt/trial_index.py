@@ -0,0 +1,74 @@
+# Trial index for segmented recordings
+# The Qt GUI records each block as a directory of short video segments plus
+# index files (frames.csv, segments.csv, trials.csv). This module looks a trial
+# up in the index and reads only its frames, seeking inside the one or two
+# segments it spans instead of decoding the block from frame 0.
+import csv
+import os
+import sys
+from concurrent.futures import ProcessPoolExecutor
+
+import cv2  # OpenCV for video processing
+
+
+def load_index(recording_dir):
+    """Returns (segments, trials) keyed by segment number and trial number."""
+    segments = {}
+    with open(os.path.join(recording_dir, 'segments.csv'), newline='') as f:
+        for row in csv.DictReader(f):
+            segments[int(row['segment'])] = {
+                'file': os.path.join(recording_dir, row['file']),
+                'first_frame': int(row['first_frame']),
+                'frame_count': int(row['frame_count']),
+            }
+    trials = {}
+    with open(os.path.join(recording_dir, 'trials.csv'), newline='') as f:
+        for row in csv.DictReader(f):
+            trials[int(row['trial'])] = {key: int(value) for key, value in row.items()}
+    return segments, trials
+
+
+def trial_frames(recording_dir, trial, index=None):
+    """Yields (frame_number, frame) for every frame recorded during a trial."""
+    segments, trials = index if index is not None else load_index(recording_dir)
+    entry = trials[trial]
+    if entry['first_frame'] < 0:
+        return  # nothing was recorded during this trial
+    for segment in range(entry['first_segment'], entry['last_segment'] + 1):
+        if segment not in segments:
+            break  # the segment was still open when the recording stopped
+        info = segments[segment]
+        start = entry['first_offset'] if segment == entry['first_segment'] else 0
+        end = entry['last_offset'] if segment == entry['last_segment'] else info['frame_count'] - 1
+
+        cap = cv2.VideoCapture(info['file'])
+        cap.set(cv2.CAP_PROP_POS_FRAMES, start)
+        for offset in range(start, end + 1):
+            ret, frame = cap.read()
+            if not ret:
+                break
+            yield info['first_frame'] + offset, frame
+        cap.release()
+
+
+def _count_frames(args):
+    recording_dir, trial = args
+    return trial, sum(1 for _ in trial_frames(recording_dir, trial))
+
+
+def main():
+    recording_dir = sys.argv[1] if len(sys.argv) > 1 else '.'
+    segments, trials = load_index(recording_dir)
+    print(f"{len(segments)} segments, {len(trials)} trials in {recording_dir}")
+
+    # Trials are independent, so they can be decoded in parallel.
+    with ProcessPoolExecutor() as pool:
+        for trial, count in pool.map(_count_frames, [(recording_dir, t) for t in sorted(trials)]):
+            entry = trials[trial]
+            print(f"Trial {trial}: frames {entry['first_frame']}-{entry['last_frame']} "
+                  f"(segment {entry['first_segment']}+{entry['first_offset']} to "
+                  f"{entry['last_segment']}+{entry['last_offset']}), {count} decoded")
+
+
+if __name__ == '__main__':
+    main()